@@ -0,0 +1,35 @@
+//
+//  allocation_counter.cpp
+//  path_planning
+//
+//  Counts the heap allocations of every thread by replacing the global
+//  operator new, so a stage can tell how many it made. The count is the
+//  thread's own and is never shared, so counting takes no atomic or lock.
+//
+
+#include "allocation_counter.hpp"
+
+#include <new>
+#include <stdlib.h>
+
+
+static thread_local long allocations = 0;
+
+long thread_allocations() {
+    return allocations;
+}
+
+/* The array and nothrow forms call this one, so every allocation is counted
+   once. */
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
@@ -0,0 +1,18 @@
+//
+//  allocation_counter.hpp
+//  path_planning
+//
+//  Counts the heap allocations of every thread by replacing the global
+//  operator new, so a stage can tell how many it made. The count is the
+//  thread's own and is never shared, so counting takes no atomic or lock.
+//
+
+#ifndef allocation_counter_hpp
+#define allocation_counter_hpp
+
+/**
+ * operator new calls made on the calling thread so far.
+ */
+long thread_allocations();
+
+#endif /* allocation_counter_hpp */
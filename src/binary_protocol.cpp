@@ -0,0 +1,201 @@
+//
+//  binary_protocol.cpp
+//  path_planning
+//
+//  Optional binary framing of telemetry and control, for clients that ask for
+//  it in the websocket handshake. Fixed-layout little-endian records replace
+//  the socket.io json; the text protocol is unchanged for the simulator.
+//
+
+#include "binary_protocol.hpp"
+
+#include <string.h>
+
+
+/* Fields are copied with memcpy, so frames need no alignment, and swapped on
+   big-endian hosts only; on x86 and arm every load is a plain move. */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static uint16_t to_le(uint16_t v) { return __builtin_bswap16(v); }
+static uint32_t to_le(uint32_t v) { return __builtin_bswap32(v); }
+static uint64_t to_le(uint64_t v) { return __builtin_bswap64(v); }
+#else
+static uint16_t to_le(uint16_t v) { return v; }
+static uint32_t to_le(uint32_t v) { return v; }
+static uint64_t to_le(uint64_t v) { return v; }
+#endif
+
+template <typename T>
+static T load(const char *p) {
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return to_le(v);
+}
+
+template <typename T>
+static char *store(char *p, T v) {
+    v = to_le(v);
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static double load_double(const char *p) {
+    uint64_t bits = load<uint64_t>(p);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static char *store_double(char *p, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return store(p, bits);
+}
+
+static char *store_header(char *p, BinaryFrameType type, uint32_t sequence) {
+    p = store(p, BINARY_MAGIC);
+    p = store(p, BINARY_VERSION);
+    p = store(p, (uint16_t)type);
+    p = store(p, sequence);
+    return store(p, (uint32_t)0);
+}
+
+// Checks magic and version; type is left to the caller
+static bool valid_header(const char *data, size_t length, uint16_t &type, uint32_t &sequence) {
+    if (length < BINARY_HEADER_SIZE || load<uint32_t>(data) != BINARY_MAGIC
+        || load<uint16_t>(data + 4) != BINARY_VERSION) {
+        return false;
+    }
+    type = load<uint16_t>(data + 6);
+    sequence = load<uint32_t>(data + 8);
+    return true;
+}
+
+TelemetryStatus decode_binary_telemetry(const char *data, size_t length, TelemetryFrame &frame, uint32_t &sequence) {
+
+    uint16_t type;
+    if (!valid_header(data, length, type, sequence)) {
+        return TELEMETRY_MALFORMED;
+    }
+    if (type != BINARY_TELEMETRY) {
+        return TELEMETRY_IGNORED;
+    }
+    if (length < BINARY_TELEMETRY_SIZE) {
+        return TELEMETRY_MALFORMED;
+    }
+
+    const char *p = data + BINARY_HEADER_SIZE;
+    uint32_t path_size = load<uint32_t>(p + 64);
+    uint32_t n_cars = load<uint32_t>(p + 68);
+    if (path_size > (uint32_t)TELEMETRY_MAX_PATH || n_cars > (uint32_t)TELEMETRY_MAX_CARS
+        || length != BINARY_TELEMETRY_SIZE + n_cars * BINARY_CAR_SIZE) {
+        return TELEMETRY_MALFORMED;
+    }
+
+    frame.x = load_double(p);
+    frame.y = load_double(p + 8);
+    frame.s = load_double(p + 16);
+    frame.d = load_double(p + 24);
+    frame.yaw = load_double(p + 32);
+    frame.speed = load_double(p + 40);
+    frame.end_path_s = load_double(p + 48);
+    frame.end_path_d = load_double(p + 56);
+    frame.path_size = path_size;
+    frame.n_cars = n_cars;
+
+    p = data + BINARY_TELEMETRY_SIZE;
+    for (uint32_t i = 0; i < n_cars; i++, p += BINARY_CAR_SIZE) {
+        frame.car_id[i] = (int32_t)load<uint32_t>(p);
+        frame.car_x[i] = load_double(p + 8);
+        frame.car_y[i] = load_double(p + 16);
+        frame.car_vx[i] = load_double(p + 24);
+        frame.car_vy[i] = load_double(p + 32);
+        frame.car_s[i] = load_double(p + 40);
+        frame.car_d[i] = load_double(p + 48);
+    }
+    return TELEMETRY_OK;
+}
+
+bool offers_protocol(const string &offered, const char *protocol) {
+    size_t begin = 0;
+    while (begin <= offered.size()) {
+        size_t end = offered.find(',', begin);
+        if (end == string::npos) {
+            end = offered.size();
+        }
+        size_t first = offered.find_first_not_of(" \t", begin);
+        size_t last = offered.find_last_not_of(" \t", end - 1);
+        if (first < end && last != string::npos && last >= first
+            && offered.compare(first, last - first + 1, protocol) == 0) {
+            return true;
+        }
+        begin = end + 1;
+    }
+    return false;
+}
+
+void encode_binary_telemetry(const TelemetryFrame &frame, uint32_t sequence, vector<char> &out) {
+
+    out.resize(BINARY_TELEMETRY_SIZE + frame.n_cars * BINARY_CAR_SIZE);
+    char *p = store_header(out.data(), BINARY_TELEMETRY, sequence);
+    p = store_double(p, frame.x);
+    p = store_double(p, frame.y);
+    p = store_double(p, frame.s);
+    p = store_double(p, frame.d);
+    p = store_double(p, frame.yaw);
+    p = store_double(p, frame.speed);
+    p = store_double(p, frame.end_path_s);
+    p = store_double(p, frame.end_path_d);
+    p = store(p, (uint32_t)frame.path_size);
+    p = store(p, (uint32_t)frame.n_cars);
+    for (int i = 0; i < frame.n_cars; i++) {
+        p = store(p, (uint32_t)frame.car_id[i]);
+        p = store(p, (uint32_t)0);
+        p = store_double(p, frame.car_x[i]);
+        p = store_double(p, frame.car_y[i]);
+        p = store_double(p, frame.car_vx[i]);
+        p = store_double(p, frame.car_vy[i]);
+        p = store_double(p, frame.car_s[i]);
+        p = store_double(p, frame.car_d[i]);
+    }
+}
+
+int decode_binary_control(const char *data, size_t length, double *next_x, double *next_y, int capacity, uint32_t &sequence) {
+
+    uint16_t type;
+    if (!valid_header(data, length, type, sequence) || type != BINARY_CONTROL || length < BINARY_CONTROL_SIZE) {
+        return -1;
+    }
+    uint32_t n = load<uint32_t>(data + BINARY_HEADER_SIZE);
+    if (n > (uint32_t)capacity || length != BINARY_CONTROL_SIZE + n * BINARY_POINT_SIZE) {
+        return -1;
+    }
+    const char *p = data + BINARY_CONTROL_SIZE;
+    for (uint32_t i = 0; i < n; i++, p += BINARY_POINT_SIZE) {
+        next_x[i] = load_double(p);
+        next_y[i] = load_double(p + 8);
+    }
+    return n;
+}
+
+void BinaryControlWriter::write(const double *next_x, const double *next_y, int n, uint32_t sequence) {
+
+    used = BINARY_CONTROL_SIZE + n * BINARY_POINT_SIZE;
+    if (buffer.size() < used) {
+        buffer.resize(used);
+    }
+    char *p = store_header(buffer.data(), BINARY_CONTROL, sequence);
+    p = store(p, (uint32_t)n);
+    p = store(p, (uint32_t)0);
+    for (int i = 0; i < n; i++) {
+        p = store_double(p, next_x[i]);
+        p = store_double(p, next_y[i]);
+    }
+}
+
+const char *BinaryControlWriter::data() const {
+    return buffer.data();
+}
+
+size_t BinaryControlWriter::size() const {
+    return used;
+}
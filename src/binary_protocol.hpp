@@ -0,0 +1,106 @@
+//
+//  binary_protocol.hpp
+//  path_planning
+//
+//  Optional binary framing of telemetry and control, for clients that ask for
+//  it in the websocket handshake. Fixed-layout little-endian records replace
+//  the socket.io json; the text protocol is unchanged for the simulator.
+//
+
+#ifndef binary_protocol_hpp
+#define binary_protocol_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "telemetry.hpp"
+
+using namespace std;
+
+// Sec-WebSocket-Protocol value a client offers to get binary frames
+const char BINARY_PROTOCOL[] = "pp-binary.v1";
+
+/**
+ * True when the Sec-WebSocket-Protocol header offered lists protocol: its
+ * comma separated tokens are trimmed and compared exactly.
+ */
+bool offers_protocol(const string &offered, const char *protocol);
+
+// First bytes of every binary frame, "PPB1" read as a little-endian u32
+const uint32_t BINARY_MAGIC = 0x31425050;
+
+const uint16_t BINARY_VERSION = 1;
+
+enum BinaryFrameType {
+    BINARY_TELEMETRY = 1,   // client to planner
+    BINARY_CONTROL = 2      // planner to client
+};
+
+/*
+ Frame layout, all fields little-endian, doubles IEEE 754:
+
+   header       u32 magic, u16 version, u16 type, u32 sequence, u32 reserved  16 bytes
+   telemetry    f64 x, y, s, d, yaw, speed, end_path_s, end_path_d            64 bytes
+                u32 path_size, u32 n_cars                                      8 bytes
+                n_cars x {i32 id, u32 reserved, f64 x, y, vx, vy, s, d}       56 bytes each
+   control      u32 n, u32 reserved                                            8 bytes
+                n x {f64 x, y}                                                16 bytes each
+
+ The telemetry frame carries only the number of previous path points left:
+ the planner keeps the points it sent, see EmittedPath. The control frame
+ echoes the sequence number of the telemetry it answers.
+ */
+const size_t BINARY_HEADER_SIZE = 16;
+
+const size_t BINARY_TELEMETRY_SIZE = BINARY_HEADER_SIZE + 72;
+
+const size_t BINARY_CAR_SIZE = 56;
+
+const size_t BINARY_CONTROL_SIZE = BINARY_HEADER_SIZE + 8;
+
+const size_t BINARY_POINT_SIZE = 16;
+
+/**
+ * Decodes a binary telemetry frame of length bytes into frame, leaving
+ * previous_path_x/y untouched, and its sequence number into sequence.
+ * Returns TELEMETRY_IGNORED for another frame type and TELEMETRY_MALFORMED
+ * when the header or length do not match. Does not allocate.
+ */
+TelemetryStatus decode_binary_telemetry(const char *data, size_t length, TelemetryFrame &frame, uint32_t &sequence);
+
+/**
+ * Encodes frame as a binary telemetry frame into out, replacing its contents.
+ * For clients and benchmarks; the planner only decodes telemetry.
+ */
+void encode_binary_telemetry(const TelemetryFrame &frame, uint32_t sequence, vector<char> &out);
+
+/**
+ * Decodes a binary control frame into at most capacity points. Returns the
+ * number of points, or -1 if the frame is not a control frame or does not fit.
+ */
+int decode_binary_control(const char *data, size_t length, double *next_x, double *next_y, int capacity, uint32_t &sequence);
+
+class BinaryControlWriter {
+public:
+
+    /**
+     * Writes the control frame answering telemetry sequence for a path of n
+     * points into the buffer, growing it only when a longer path than ever
+     * before is written.
+     */
+    void write(const double *next_x, const double *next_y, int n, uint32_t sequence);
+
+    // the last frame written, valid until the next write
+    const char *data() const;
+
+    size_t size() const;
+
+private:
+
+    vector<char> buffer;
+
+    size_t used = 0;
+};
+
+#endif /* binary_protocol_hpp */
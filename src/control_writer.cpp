@@ -0,0 +1,382 @@
+//
+//  control_writer.cpp
+//  path_planning
+//
+//  Serializer for the control event sent back to the simulator. Writes the
+//  path straight into a buffer reused from frame to frame.
+//
+
+#include "control_writer.hpp"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+
+// longest number written: sign, 17 digits, point, exponent
+static const int MAX_NUMBER = 32;
+
+static const char HEAD[] = "42[\"control\",{\"next_x\":";
+
+static const char MIDDLE[] = ",\"next_y\":";
+
+static const char TAIL[] = "}]";
+
+// fixed precision is printed from an integer up to this many decimals
+static const int MAX_FIXED_PRECISION = 9;
+
+static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+// Shortest round-trip digits by Grisu2 (Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers"): the digits always read back
+// to the same double and are the shortest ones in nearly all cases.
+
+// 64-bit significand and binary exponent: f * 2^e
+struct DiyFp {
+    uint64_t f;
+    int e;
+};
+
+struct CachedPower {
+    uint64_t f;
+    int e;
+    int k;
+};
+
+// normalized 10^k for k = -300, -292, ..., 324
+static const CachedPower CACHED_POWERS[] = {
+    {0xAB70FE17C79AC6CAULL, -1060, -300},
+    {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+    {0xBE5691EF416BD60CULL, -1007, -284},
+    {0x8DD01FAD907FFC3CULL,  -980, -276},
+    {0xD3515C2831559A83ULL,  -954, -268},
+    {0x9D71AC8FADA6C9B5ULL,  -927, -260},
+    {0xEA9C227723EE8BCBULL,  -901, -252},
+    {0xAECC49914078536DULL,  -874, -244},
+    {0x823C12795DB6CE57ULL,  -847, -236},
+    {0xC21094364DFB5637ULL,  -821, -228},
+    {0x9096EA6F3848984FULL,  -794, -220},
+    {0xD77485CB25823AC7ULL,  -768, -212},
+    {0xA086CFCD97BF97F4ULL,  -741, -204},
+    {0xEF340A98172AACE5ULL,  -715, -196},
+    {0xB23867FB2A35B28EULL,  -688, -188},
+    {0x84C8D4DFD2C63F3BULL,  -661, -180},
+    {0xC5DD44271AD3CDBAULL,  -635, -172},
+    {0x936B9FCEBB25C996ULL,  -608, -164},
+    {0xDBAC6C247D62A584ULL,  -582, -156},
+    {0xA3AB66580D5FDAF6ULL,  -555, -148},
+    {0xF3E2F893DEC3F126ULL,  -529, -140},
+    {0xB5B5ADA8AAFF80B8ULL,  -502, -132},
+    {0x87625F056C7C4A8BULL,  -475, -124},
+    {0xC9BCFF6034C13053ULL,  -449, -116},
+    {0x964E858C91BA2655ULL,  -422, -108},
+    {0xDFF9772470297EBDULL,  -396, -100},
+    {0xA6DFBD9FB8E5B88FULL,  -369,  -92},
+    {0xF8A95FCF88747D94ULL,  -343,  -84},
+    {0xB94470938FA89BCFULL,  -316,  -76},
+    {0x8A08F0F8BF0F156BULL,  -289,  -68},
+    {0xCDB02555653131B6ULL,  -263,  -60},
+    {0x993FE2C6D07B7FACULL,  -236,  -52},
+    {0xE45C10C42A2B3B06ULL,  -210,  -44},
+    {0xAA242499697392D3ULL,  -183,  -36},
+    {0xFD87B5F28300CA0EULL,  -157,  -28},
+    {0xBCE5086492111AEBULL,  -130,  -20},
+    {0x8CBCCC096F5088CCULL,  -103,  -12},
+    {0xD1B71758E219652CULL,   -77,   -4},
+    {0x9C40000000000000ULL,   -50,    4},
+    {0xE8D4A51000000000ULL,   -24,   12},
+    {0xAD78EBC5AC620000ULL,     3,   20},
+    {0x813F3978F8940984ULL,    30,   28},
+    {0xC097CE7BC90715B3ULL,    56,   36},
+    {0x8F7E32CE7BEA5C70ULL,    83,   44},
+    {0xD5D238A4ABE98068ULL,   109,   52},
+    {0x9F4F2726179A2245ULL,   136,   60},
+    {0xED63A231D4C4FB27ULL,   162,   68},
+    {0xB0DE65388CC8ADA8ULL,   189,   76},
+    {0x83C7088E1AAB65DBULL,   216,   84},
+    {0xC45D1DF942711D9AULL,   242,   92},
+    {0x924D692CA61BE758ULL,   269,  100},
+    {0xDA01EE641A708DEAULL,   295,  108},
+    {0xA26DA3999AEF774AULL,   322,  116},
+    {0xF209787BB47D6B85ULL,   348,  124},
+    {0xB454E4A179DD1877ULL,   375,  132},
+    {0x865B86925B9BC5C2ULL,   402,  140},
+    {0xC83553C5C8965D3DULL,   428,  148},
+    {0x952AB45CFA97A0B3ULL,   455,  156},
+    {0xDE469FBD99A05FE3ULL,   481,  164},
+    {0xA59BC234DB398C25ULL,   508,  172},
+    {0xF6C69A72A3989F5CULL,   534,  180},
+    {0xB7DCBF5354E9BECEULL,   561,  188},
+    {0x88FCF317F22241E2ULL,   588,  196},
+    {0xCC20CE9BD35C78A5ULL,   614,  204},
+    {0x98165AF37B2153DFULL,   641,  212},
+    {0xE2A0B5DC971F303AULL,   667,  220},
+    {0xA8D9D1535CE3B396ULL,   694,  228},
+    {0xFB9B7CD9A4A7443CULL,   720,  236},
+    {0xBB764C4CA7A44410ULL,   747,  244},
+    {0x8BAB8EEFB6409C1AULL,   774,  252},
+    {0xD01FEF10A657842CULL,   800,  260},
+    {0x9B10A4E5E9913129ULL,   827,  268},
+    {0xE7109BFBA19C0C9DULL,   853,  276},
+    {0xAC2820D9623BF429ULL,   880,  284},
+    {0x80444B5E7AA7CF85ULL,   907,  292},
+    {0xBF21E44003ACDD2DULL,   933,  300},
+    {0x8E679C2F5E44FF8FULL,   960,  308},
+    {0xD433179D9C8CB841ULL,   986,  316},
+    {0x9E19DB92B4E31BA9ULL,  1013,  324},
+};
+
+static const int CACHED_POWERS_MIN_K = -300;
+
+static const int CACHED_POWERS_K_STEP = 8;
+
+// range the binary exponent of the scaled boundaries is brought into
+static const int GRISU_ALPHA = -60;
+
+static DiyFp multiply(DiyFp x, DiyFp y) {
+    unsigned __int128 product = (unsigned __int128)x.f * y.f;
+    uint64_t high = (uint64_t)(product >> 64);
+    uint64_t low = (uint64_t)product;
+    DiyFp result = {high + (low >> 63), x.e + y.e + 64};
+    return result;
+}
+
+static DiyFp normalize(DiyFp x) {
+    int shift = __builtin_clzll(x.f);
+    DiyFp result = {x.f << shift, x.e - shift};
+    return result;
+}
+
+static void grisu_round(char *digits, int length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k) {
+    while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+        digits[length - 1]--;
+        rest += ten_k;
+    }
+}
+
+// Digits of a positive finite value; value = digits * 10^exponent
+static int grisu2(double value, char *digits, int &exponent) {
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t fraction = bits & ((1ULL << 52) - 1);
+    int biased = (int)(bits >> 52) & 0x7FF;
+
+    DiyFp v = {fraction, 1 - 1075};
+    if (biased != 0) {
+        v.f |= 1ULL << 52;
+        v.e = biased - 1075;
+    }
+
+    /* Boundaries halfway to the neighbouring doubles; the lower one is closer
+       when v is a power of two. */
+    bool lower_closer = fraction == 0 && biased > 1;
+    DiyFp m_plus = {2 * v.f + 1, v.e - 1};
+    m_plus = normalize(m_plus);
+    DiyFp m_minus = {2 * v.f - 1, v.e - 1};
+    if (lower_closer) {
+        m_minus.f = 4 * v.f - 1;
+        m_minus.e = v.e - 2;
+    }
+    m_minus.f <<= m_minus.e - m_plus.e;
+    m_minus.e = m_plus.e;
+    DiyFp w = normalize(v);
+
+    /* Scale by a cached 10^-k that brings the exponent into [-60, -32]. */
+    int f = GRISU_ALPHA - m_plus.e - 1;
+    int k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+    const CachedPower &cached = CACHED_POWERS[(-CACHED_POWERS_MIN_K + k + CACHED_POWERS_K_STEP - 1) / CACHED_POWERS_K_STEP];
+    DiyFp c = {cached.f, cached.e};
+
+    w = multiply(w, c);
+    DiyFp low = multiply(m_minus, c);
+    DiyFp high = multiply(m_plus, c);
+    low.f++;
+    high.f--;
+    exponent = -cached.k;
+
+    /* Digits of high, until what is left of it is within delta. */
+    uint64_t delta = high.f - low.f;
+    uint64_t dist = high.f - w.f;
+    int shift = -high.e;
+    uint64_t one = 1ULL << shift;
+    uint32_t p1 = (uint32_t)(high.f >> shift);
+    uint64_t p2 = high.f & (one - 1);
+
+    uint32_t pow10 = 1;
+    int n = 1;
+    while (n < 10 && p1 / 10 >= pow10) {
+        pow10 *= 10;
+        n++;
+    }
+
+    int length = 0;
+    while (n > 0) {
+        digits[length++] = (char)('0' + p1 / pow10);
+        p1 %= pow10;
+        n--;
+        uint64_t rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            exponent += n;
+            grisu_round(digits, length, dist, delta, rest, (uint64_t)pow10 << shift);
+            return length;
+        }
+        pow10 /= 10;
+    }
+
+    int m = 0;
+    while (true) {
+        p2 *= 10;
+        digits[length++] = (char)('0' + (p2 >> shift));
+        p2 &= one - 1;
+        m++;
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta) {
+            break;
+        }
+    }
+    exponent -= m;
+    grisu_round(digits, length, dist, delta, p2, one);
+    return length;
+}
+
+// Places the point in digits * 10^exponent the way %g does: plain notation
+// for decimal exponents from -4 to 15, scientific otherwise.
+static char *format_digits(char *out, const char *digits, int length, int exponent) {
+
+    int point = length + exponent;
+    if (length <= point && point <= 15) {
+        memcpy(out, digits, length);
+        memset(out + length, '0', point - length);
+        return out + point;
+    }
+    if (0 < point && point <= 15) {
+        memcpy(out, digits, point);
+        out[point] = '.';
+        memcpy(out + point + 1, digits + point, length - point);
+        return out + length + 1;
+    }
+    if (-4 < point && point <= 0) {
+        out[0] = '0';
+        out[1] = '.';
+        memset(out + 2, '0', -point);
+        memcpy(out + 2 - point, digits, length);
+        return out + 2 - point + length;
+    }
+
+    *out++ = digits[0];
+    if (length > 1) {
+        *out++ = '.';
+        memcpy(out, digits + 1, length - 1);
+        out += length - 1;
+    }
+    int e = point - 1;
+    *out++ = 'e';
+    *out++ = e < 0 ? '-' : '+';
+    e = e < 0 ? -e : e;
+    if (e >= 100) {
+        *out++ = (char)('0' + e / 100);
+    }
+    if (e >= 10) {
+        *out++ = (char)('0' + e / 10 % 10);
+    }
+    *out++ = (char)('0' + e % 10);
+    return out;
+}
+
+ControlWriter::ControlWriter(int precision) : precision(precision) {}
+
+void ControlWriter::set_precision(int precision) {
+    this->precision = precision;
+}
+
+void ControlWriter::write(const double *next_x, const double *next_y, int n) {
+
+    size_t needed = sizeof(HEAD) + sizeof(MIDDLE) + sizeof(TAIL) + 2 * (size_t)n * (MAX_NUMBER + 1) + 4;
+    if (buffer.size() < needed) {
+        buffer.resize(needed);
+    }
+
+    char *out = &buffer[0];
+    out = append(out, HEAD, sizeof(HEAD) - 1);
+    out = append_array(out, next_x, n);
+    out = append(out, MIDDLE, sizeof(MIDDLE) - 1);
+    out = append_array(out, next_y, n);
+    out = append(out, TAIL, sizeof(TAIL) - 1);
+    used = out - &buffer[0];
+}
+
+const char *ControlWriter::data() const {
+    return buffer.empty() ? "" : &buffer[0];
+}
+
+size_t ControlWriter::size() const {
+    return used;
+}
+
+char *ControlWriter::append(char *out, const char *text, size_t length) {
+    memcpy(out, text, length);
+    return out + length;
+}
+
+char *ControlWriter::append_array(char *out, const double *values, int n) const {
+    *out++ = '[';
+    for (int i = 0; i < n; i++) {
+        if (i > 0) {
+            *out++ = ',';
+        }
+        out = append_number(out, values[i]);
+    }
+    *out++ = ']';
+    return out;
+}
+
+char *ControlWriter::append_number(char *out, double value) const {
+
+    if (!isfinite(value)) {
+        memcpy(out, "null", 4);
+        return out + 4;
+    }
+
+    if (precision >= 0 && precision <= MAX_FIXED_PRECISION && fabs(value) * POW10[precision] < 9e15) {
+        /* Scaled to an integer, printed backwards; trailing zero decimals and
+           a bare point are dropped. */
+        int64_t scaled = llround(fabs(value) * POW10[precision]);
+        char digits[24];
+        int count = 0;
+        int decimals = precision;
+        while (decimals > 0 && scaled % 10 == 0) {
+            scaled /= 10;
+            decimals--;
+        }
+        do {
+            digits[count++] = (char)('0' + scaled % 10);
+            scaled /= 10;
+        } while (scaled > 0 || count <= decimals);
+
+        if (value < 0 && (count > 1 || digits[0] != '0')) {
+            *out++ = '-';
+        }
+        for (int i = count - 1; i >= 0; i--) {
+            *out++ = digits[i];
+            if (i == decimals && i > 0) {
+                *out++ = '.';
+            }
+        }
+        return out;
+    }
+
+    if (signbit(value)) {
+        *out++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        *out++ = '0';
+        return out;
+    }
+    char digits[MAX_NUMBER];
+    int exponent;
+    int length = grisu2(value, digits, exponent);
+    return format_digits(out, digits, length, exponent);
+}
@@ -0,0 +1,58 @@
+//
+//  control_writer.hpp
+//  path_planning
+//
+//  Serializer for the control event sent back to the simulator. Writes the
+//  path straight into a buffer reused from frame to frame.
+//
+
+#ifndef control_writer_hpp
+#define control_writer_hpp
+
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+class ControlWriter {
+public:
+
+    // precision meaning: print the shortest digits that read back to the same double
+    static const int SHORTEST = -1;
+
+    /**
+     * Constructor. precision is the number of decimals printed, or SHORTEST.
+     * Fixed precision drops trailing zeros, e.g. 3 prints millimetres.
+     */
+    ControlWriter(int precision = SHORTEST);
+
+    void set_precision(int precision);
+
+    /**
+     * Writes 42["control",{"next_x":[...],"next_y":[...]}] for a path of n
+     * points into the buffer, growing it only when a longer path than ever
+     * before is written. Non-finite values are written as null.
+     */
+    void write(const double *next_x, const double *next_y, int n);
+
+    // the last message written, valid until the next write
+    const char *data() const;
+
+    size_t size() const;
+
+private:
+
+    vector<char> buffer;
+
+    size_t used = 0;
+
+    int precision;
+
+    char *append(char *out, const char *text, size_t length);
+
+    char *append_number(char *out, double value) const;
+
+    char *append_array(char *out, const double *values, int n) const;
+};
+
+#endif /* control_writer_hpp */
@@ -41,23 +41,27 @@ float logistic(float x){
     
 }
 
-float max_accel_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data){
+float max_accel_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data){
     float a = (trajectory[1].v-vehicle.v)/vehicle.dt;
     if (abs(a) >= vehicle.max_acceleration){
-        cout<<"max acc "<<endl;
+        if (Vehicle::verbose) {
+            cout<<"max acc "<<endl;
+        }
         return 1.0;
     }else{
         return 0.0;
     }
 }
 
-float max_jerk_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data){
+float max_jerk_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data){
 
     double max_jerk = abs(trajectory[1].a- vehicle.a)/vehicle.dt;
     //cout <<"jerk is "<<max_jerk<<endl;
     
     if (max_jerk >= vehicle.MAX_JERK){
-        cout<<"!!!! max jerk"<<endl;
+        if (Vehicle::verbose) {
+            cout<<"!!!! max jerk"<<endl;
+        }
         return 1.0;
         
     }else{
@@ -67,24 +71,23 @@ float max_jerk_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector
 
 
 
-float collision_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data){
+float collision_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data){
     /*
-    Binary cost function which penalizes collisions.
+    Penalizes collisions by their probability over the other cars' lane-change intents.
+    Binary when every car surely keeps its lane.
     */
-    float nearest = get_nearest_distance(trajectory,predictions);
-    if (nearest < COLLISION_BUFFER){
+    float risk = expected_collision_risk(trajectory, traffic);
+    if (Vehicle::verbose && risk > 0.5){
         cout<<"<!!!!!!!!!! collision"<<endl;
-        return 1.0;
-    }else{
-        return 0.0;
     }
+    return risk;
     
 }
-float buffer_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data){
+float buffer_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data){
     /*
     Penalizes getting close to other vehicles.
     */
-    float nearest = get_nearest_distance(trajectory,predictions);
+    float nearest = get_nearest_distance(trajectory,traffic);
     //cout<<"nearest "<<nearest<<endl;
     return logistic(2*VEHICLE_RADIUS / nearest);
     
@@ -92,7 +95,7 @@ float buffer_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<V
 
 
 
-float goal_distance_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data) {
+float goal_distance_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data) {
     /*
      Cost increases based on distance of intended lane (for planning a lane change) and final lane of trajectory.
      Cost of being out of goal lane also becomes larger as vehicle approaches goal distance.
@@ -112,12 +115,12 @@ float goal_distance_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, v
 
 }
 
-double inefficiency_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data) {
+double inefficiency_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data) {
     /*
      Cost becomes higher for trajectories with intended lane and final lane that have slower traffic.
      */
 
-    double proposed_speed_intended = lane_speed(predictions, data["intended_lane"],trajectory[0].s);
+    double proposed_speed_intended = lane_speed(traffic, data["intended_lane"],trajectory[0].s);
     
     
     if (proposed_speed_intended <= 0){
@@ -125,7 +128,7 @@ double inefficiency_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, v
     }
 
     
-    double proposed_speed_final = lane_speed(predictions,data["final_lane"],trajectory[1].s);
+    double proposed_speed_final = lane_speed(traffic,data["final_lane"],trajectory[1].s);
     
     if (proposed_speed_final <=0){
         proposed_speed_final = vehicle.target_speed;
@@ -138,45 +141,33 @@ double inefficiency_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, v
     return cost;
 }
 
-double lane_speed(map<int, vector<Vehicle>> predictions, int lane, double s) {
+double lane_speed(const TrafficSnapshot &traffic, int lane, double s) {
     /*
-     Get the speed to the nearest
+     Get the speed of the nearest vehicle ahead in lane, within 100 m; -1 if there is none.
+     The snapshot holds no ego (id -1).
      */
-    double ds_min = pow(10,5);
-    double vel = -1.0;
-    
-    for (map<int, vector<Vehicle>>::iterator it = predictions.begin(); it != predictions.end(); ++it) {
-        Vehicle temp = it->second[0];
-        int key = it->first;
-        if (temp.lane == lane && key != -1) {
-            //cout<<"id "<<key<<"lane "<<vehicle.lane<<" speed "<<vehicle.v<<endl;
-            double delta = fabs(temp.s-s);
-            if (delta < ds_min && delta< 100 && temp.s > s ){
-                ds_min = delta;
-                vel = temp.v;
-            }
-            
-        }
+    int ahead = traffic.first_ahead(lane, s);
+    if (ahead >= 0 && traffic.s[ahead] - s < 100) {
+        return traffic.v[ahead];
     }
-    //cout <<"vel "<<vel<<endl;
-    return vel;
+    return -1.0;
 
 }
 
-float calculate_cost(Vehicle vehicle, map<int, vector<Vehicle>> predictions, vector<Vehicle> trajectory) {
+float calculate_cost(const Vehicle &vehicle, const TrafficSnapshot &traffic, const vector<Vehicle> &trajectory) {
     /*
      Sum weighted cost functions to get total cost for trajectory.
      */
 
-    map<string, float> trajectory_data = get_helper_data(vehicle, trajectory, predictions);
+    map<string, float> trajectory_data = get_helper_data(vehicle, trajectory, traffic);
     double cost = 0.0;
     
     //Add additional cost functions here.
-    vector< function<float(Vehicle, vector<Vehicle>, map<int, vector<Vehicle>>, map<string, float>)>> cf_list = {inefficiency_cost,goal_distance_cost,collision_cost,buffer_cost,max_accel_cost,max_jerk_cost};
+    vector< function<float(const Vehicle &, const vector<Vehicle> &, const TrafficSnapshot &, map<string, float> &)>> cf_list = {inefficiency_cost,goal_distance_cost,collision_cost,buffer_cost,max_accel_cost,max_jerk_cost};
     vector<float> weight_list = {EFFICIENCY,REACH_GOAL,COLLISION,BUFFER,ACC,JERK};
     
     for (int i = 0; i < cf_list.size(); i++) {
-        double new_cost = weight_list[i]*cf_list[i](vehicle, trajectory, predictions, trajectory_data);
+        double new_cost = weight_list[i]*cf_list[i](vehicle, trajectory, traffic, trajectory_data);
         cost += new_cost;
     }
     //cout <<"cost is"<<cost;
@@ -184,7 +175,7 @@ float calculate_cost(Vehicle vehicle, map<int, vector<Vehicle>> predictions, vec
     
 }
 
-map<string, float> get_helper_data(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions) {
+map<string, float> get_helper_data(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic) {
     /*
      Generate helper data to use in cost functions:
      intended_lane: +/- 1 from the current lane if the vehicle is planning or executing a lane change.
@@ -195,7 +186,7 @@ map<string, float> get_helper_data(Vehicle vehicle, vector<Vehicle> trajectory,
      a lane change in the cost functions.
      */
     map<string, float> trajectory_data;
-    Vehicle trajectory_last = trajectory[1];
+    const Vehicle &trajectory_last = trajectory[1];
     float intended_lane;
     
     
@@ -217,16 +208,47 @@ map<string, float> get_helper_data(Vehicle vehicle, vector<Vehicle> trajectory,
     return trajectory_data;
 }
 
-float get_nearest_distance(vector<Vehicle> trajectory,map<int, vector<Vehicle>> predictions){
+float expected_collision_risk(const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic){
+    /*
+     Probability that a car is within COLLISION_BUFFER of the end of the trajectory, overlapping its lane,
+     at the decision time: under each lane-change mode a car is where that mode has taken it by then,
+     and the hits are weighted by the mode's probability. A car hit under every mode is a sure collision.
+     Only the lane and the lanes beside it can reach the ego's lane.
+     */
+    int lane = trajectory[1].lane;
+    double s = trajectory[1].s;
+    // the lane change is instantaneous in the trajectory, so the ego ends on its lane centre
+    double d = 2 + 4*lane;
+    double clear = 1.0;
+    for (int l = lane - 1; l <= lane + 1; l++) {
+        for (int i = traffic.lane_begin(l); i < traffic.lane_end(l); i++) {
+            if (fabs(s - traffic.s[i]) >= COLLISION_BUFFER) {
+                continue;
+            }
+            double p_keep = 1 - traffic.p_left[i] - traffic.p_right[i];
+            bool hit_keep = fabs(traffic.d_keep[i] - d) < 2;
+            bool hit_left = fabs(traffic.d_left[i] - d) < 2;
+            bool hit_right = fabs(traffic.d_right[i] - d) < 2;
+            if ((hit_keep || p_keep <= 0) && (hit_left || traffic.p_left[i] <= 0)
+                && (hit_right || traffic.p_right[i] <= 0)) {
+                return 1.0;
+            }
+            double p_hit = (hit_keep ? p_keep : 0) + (hit_left ? traffic.p_left[i] : 0)
+                         + (hit_right ? traffic.p_right[i] : 0);
+            clear *= 1 - p_hit;
+        }
+    }
+    return 1.0 - clear;
+}
+
+float get_nearest_distance(const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic){
     float min_dist = pow(10,5);
-    Vehicle temp_vehicle;
-    for (map<int, vector<Vehicle>>::iterator it = predictions.begin(); it != predictions.end(); ++it) {
-        temp_vehicle = it->second[0];
-        if(trajectory[1].lane == temp_vehicle.lane ){
-                float dist = sqrt((trajectory[1].s - temp_vehicle.s)*(trajectory[1].s - temp_vehicle.s) + (trajectory[1].d - temp_vehicle.d)*(trajectory[1].d - temp_vehicle.d)) ;
-                if(dist < min_dist){
-                    min_dist = dist;
-                }
+    // the cars of the lane are one contiguous range of the snapshot
+    int lane = trajectory[1].lane;
+    for (int i = traffic.lane_begin(lane); i < traffic.lane_end(lane); i++) {
+        float dist = sqrt((trajectory[1].s - traffic.s[i])*(trajectory[1].s - traffic.s[i]) + (trajectory[1].d - traffic.d[i])*(trajectory[1].d - traffic.d[i])) ;
+        if(dist < min_dist){
+            min_dist = dist;
         }
     }
     return min_dist;
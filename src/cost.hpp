@@ -14,22 +14,24 @@
 
 using namespace std;
 
-float calculate_cost(Vehicle vehicle, map<int, vector<Vehicle>> predictions, vector<Vehicle> trajectory);
+float calculate_cost(const Vehicle &vehicle, const TrafficSnapshot &traffic, const vector<Vehicle> &trajectory);
 
-float goal_distance_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data);
+float goal_distance_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data);
 
-double inefficiency_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data);
+double inefficiency_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data);
 
-double lane_speed(map<int, vector<Vehicle>> predictions, int lane, double s);
+double lane_speed(const TrafficSnapshot &traffic, int lane, double s);
 
-map<string, float> get_helper_data(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions);
+map<string, float> get_helper_data(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic);
 
-float collision_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data);
+float collision_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data);
 
-float buffer_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data);
+float buffer_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data);
+
+float expected_collision_risk(const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic);
 
 float logistic(float x);
 
-float get_nearest_distance(vector<Vehicle> trajectory,map<int, vector<Vehicle>> predictions);
+float get_nearest_distance(const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic);
 
 #endif /* cost_hpp */
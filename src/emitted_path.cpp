@@ -0,0 +1,82 @@
+//
+//  emitted_path.cpp
+//  path_planning
+//
+//  Ring buffer of the path points sent to the simulator, with the state the
+//  planner generated them with. The simulator echoes back the points it has
+//  not driven yet; how many, and the s and d of the last, line this buffer up
+//  with it.
+//
+
+#include "emitted_path.hpp"
+
+#include <math.h>
+
+// [m] how far end_path_s/d may be off our point, as the simulator's own map
+// projects it; less than a frame's worth of points at speed
+static const double END_TOLERANCE = 1.0;
+
+EmittedPath::EmittedPath(int capacity) {
+    unsigned size = 1;
+    while ((int)size < capacity) {
+        size <<= 1;
+    }
+    points.resize(size);
+    mask = size - 1;
+}
+
+int EmittedPath::consume(int remaining, double end_s, double end_d, double max_s) {
+    if (remaining < 0 || remaining > size()) {
+        clear();
+        return -1;
+    }
+    if (remaining == 0) {
+        int driven = size();
+        head = tail;
+        return driven;
+    }
+    /* Usually the newest point; the nearest one otherwise, where the path the
+       simulator still drives ended. */
+    int end = -1;
+    double best = END_TOLERANCE;
+    for (int i = size() - 1; i >= remaining - 1; i--) {
+        const PathPoint &point = (*this)[i];
+        double ds = end_s - point.s;
+        ds -= nearbyint(ds / max_s) * max_s;
+        if (fabs(ds) < best && fabs(end_d - point.d) < END_TOLERANCE) {
+            best = fabs(ds);
+            end = i;
+        }
+    }
+    if (end < 0) {
+        clear();
+        return -1;
+    }
+    tail = head + end + 1;
+    head = tail - remaining;
+    return end + 1 - remaining;
+}
+
+void EmittedPath::push(const PathPoint &point) {
+    points[tail & mask] = point;
+    tail++;
+    if (tail - head > points.size()) {
+        head = tail - points.size();
+    }
+}
+
+void EmittedPath::clear() {
+    head = tail = 0;
+}
+
+int EmittedPath::size() const {
+    return (int)(tail - head);
+}
+
+const PathPoint &EmittedPath::operator[](int i) const {
+    return points[(head + i) & mask];
+}
+
+const PathPoint &EmittedPath::back() const {
+    return points[(tail - 1) & mask];
+}
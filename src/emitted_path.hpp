@@ -0,0 +1,72 @@
+//
+//  emitted_path.hpp
+//  path_planning
+//
+//  Ring buffer of the path points sent to the simulator, with the state the
+//  planner generated them with. The simulator echoes back the points it has
+//  not driven yet; how many, and the s and d of the last, line this buffer up
+//  with it.
+//
+
+#ifndef emitted_path_hpp
+#define emitted_path_hpp
+
+#include <vector>
+
+using namespace std;
+
+// One point sent to the simulator, 0.02 s after the one before it
+struct PathPoint {
+    double x;
+    double y;
+    double s;
+    double d;
+    double v;   // [m/s]
+    double a;   // [m/s^2]
+};
+
+class EmittedPath {
+public:
+
+    /**
+     * Constructor. capacity is rounded up to a power of two and must exceed
+     * the longest path the planner sends.
+     */
+    EmittedPath(int capacity = 256);
+
+    /**
+     * Drops the points the simulator drove since the last frame, given the
+     * size of its previous_path arrays and end_path_s/d, s wrapping at max_s.
+     * A frame sent before the simulator took our last path ends on an older
+     * point: the newer ones are dropped too. Returns how many points were
+     * driven, or -1, leaving the buffer empty, if no point ends the path
+     * (first frame, reconnect): the caller then rebuilds it from the echoed
+     * points.
+     */
+    int consume(int remaining, double end_s, double end_d, double max_s);
+
+    void push(const PathPoint &point);
+
+    void clear();
+
+    int size() const;
+
+    // i = 0 is the next point the car drives to
+    const PathPoint &operator[](int i) const;
+
+    // end of the path, where the planner continues from
+    const PathPoint &back() const;
+
+private:
+
+    vector<PathPoint> points;
+
+    unsigned mask;
+
+    // index of the oldest point and of one past the newest, never wrapped
+    unsigned head = 0;
+
+    unsigned tail = 0;
+};
+
+#endif /* emitted_path_hpp */
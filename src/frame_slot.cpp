@@ -0,0 +1,51 @@
+//
+//  frame_slot.cpp
+//  path_planning
+//
+//  Ingestion stage between a listener and the planner. Holds the newest
+//  frame of a connection that has not been planned yet; a newer frame
+//  replaces it, so a planner that falls behind skips stale telemetry instead
+//  of working through a queue of it.
+//
+
+#include "frame_slot.hpp"
+
+
+string IngestCounters::report() const {
+    return to_string(received.load()) + " received, " + to_string(dropped.load()) + " dropped; " + queue_delay.report();
+}
+
+FrameSlot::FrameSlot() : middle(2) {}
+
+IngestFrame &FrameSlot::back() {
+    return buffers[back_index];
+}
+
+bool FrameSlot::publish(IngestCounters &counters) {
+    counters.received.fetch_add(1, memory_order_relaxed);
+    int previous = middle.exchange(back_index | FRESH, memory_order_acq_rel);
+    back_index = previous & ~FRESH;
+    if (previous & FRESH) {
+        counters.dropped.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+IngestFrame *FrameSlot::take(long &waited_ns, IngestCounters &counters) {
+    /* Only the reader clears FRESH, so it cannot vanish between the check and
+       the exchange. */
+    if (!(middle.load(memory_order_acquire) & FRESH)) {
+        return nullptr;
+    }
+    int previous = middle.exchange(front_index, memory_order_acq_rel);
+    front_index = previous & ~FRESH;
+    IngestFrame &frame = buffers[front_index];
+    waited_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - frame.arrival).count();
+    counters.queue_delay.record(waited_ns);
+    return &frame;
+}
+
+bool FrameSlot::waiting() const {
+    return middle.load(memory_order_acquire) & FRESH;
+}
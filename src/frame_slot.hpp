@@ -0,0 +1,107 @@
+//
+//  frame_slot.hpp
+//  path_planning
+//
+//  Ingestion stage between a listener and the planner. Holds the newest
+//  frame of a connection that has not been planned yet; a newer frame
+//  replaces it, so a planner that falls behind skips stale telemetry instead
+//  of working through a queue of it.
+//
+
+#ifndef frame_slot_hpp
+#define frame_slot_hpp
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "latency_counters.hpp"
+#include "telemetry.hpp"
+
+using namespace std;
+
+// Per-listener counts of the frames coming through its slots
+struct IngestCounters {
+
+    atomic<long> received;
+
+    // superseded by a newer frame before they were planned
+    atomic<long> dropped;
+
+    // time frames waited in the slot
+    LatencyCounters queue_delay;
+
+    IngestCounters(const string &name) : received(0), dropped(0), queue_delay(name + " queue") {}
+
+    // received and dropped counts, then the queue delay report
+    string report() const;
+};
+
+// One message as taken in, decoded on the listener thread
+struct IngestFrame {
+
+    TelemetryStatus status;
+
+    bool binary;
+
+    // binary protocol sequence number to answer with
+    uint32_t sequence;
+
+    TelemetryFrame frame;
+
+    // the text message itself, for when the planner needs the echoed path
+    vector<char> message;
+
+    chrono::steady_clock::time_point arrival;
+};
+
+/* A triple buffer: the writer fills back(), publish() swaps it with the
+   middle buffer and take() swaps the middle with the reader's, so neither side
+   waits for the other and a frame is never copied. */
+class FrameSlot {
+public:
+
+    FrameSlot();
+
+    FrameSlot(const FrameSlot &) = delete;
+    FrameSlot &operator=(const FrameSlot &) = delete;
+
+    // writer side: the buffer to fill before publish()
+    IngestFrame &back();
+
+    /**
+     * Writer side. Makes back() the newest frame, dropping the frame still
+     * waiting, if any. Returns true when none was waiting.
+     */
+    bool publish(IngestCounters &counters);
+
+    /**
+     * Reader side. The newest frame published since the last take, or nullptr.
+     * It stays valid until the next take. Records, and returns in waited_ns,
+     * how long it waited.
+     */
+    IngestFrame *take(long &waited_ns, IngestCounters &counters);
+
+    // true while a published frame has not been taken
+    bool waiting() const;
+
+private:
+
+    // set in middle while it holds a frame not taken yet
+    static const int FRESH = 4;
+
+    IngestFrame buffers[3];
+
+    // owned by the writer
+    int back_index = 0;
+
+    // owned by the reader
+    int front_index = 1;
+
+    // index of the buffer between them, plus FRESH
+    atomic<int> middle;
+};
+
+#endif /* frame_slot_hpp */
@@ -0,0 +1,134 @@
+//
+//  frenet.cpp
+//  path_planning
+//
+//  Conversions between map (x,y) and Frenet (s,d) coordinates.
+//
+
+#include "frenet.hpp"
+
+#include <algorithm>
+
+
+double distance(double x1, double y1, double x2, double y2)
+{
+    return sqrt((x2-x1)*(x2-x1)+(y2-y1)*(y2-y1));
+}
+
+int ClosestWaypoint(double x, double y, const WaypointIndex &index)
+{
+    return index.closest(x,y);
+}
+
+int NextWaypoint(double x, double y, double theta, const WaypointIndex &index)
+{
+    return index.next(x,y,theta);
+}
+
+// Transform from Cartesian x,y coordinates to Frenet s,d coordinates
+vector<double> getFrenet(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s, const WaypointIndex &index)
+{
+    int next_wp = NextWaypoint(x,y, theta, index);
+    
+    return getFrenetOnSegment(x, y, next_wp, maps_x, maps_y, maps_cum_s);
+    
+}
+
+// Frenet s,d of x,y projected onto the map segment ending at waypoint next_wp
+vector<double> getFrenetOnSegment(double x, double y, int next_wp, const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s)
+{
+    int prev_wp;
+    prev_wp = next_wp-1;
+    if(next_wp == 0)
+    {
+        prev_wp  = maps_x.size()-1;
+    }
+    
+    double n_x = maps_x[next_wp]-maps_x[prev_wp];
+    double n_y = maps_y[next_wp]-maps_y[prev_wp];
+    double x_x = x - maps_x[prev_wp];
+    double x_y = y - maps_y[prev_wp];
+    
+    // find the projection of x onto n
+    double proj_norm = (x_x*n_x+x_y*n_y)/(n_x*n_x+n_y*n_y);
+    double proj_x = proj_norm*n_x;
+    double proj_y = proj_norm*n_y;
+    
+    double frenet_d = distance(x_x,x_y,proj_x,proj_y);
+    
+    //see if d value is positive or negative by comparing it to a center point
+    
+    double center_x = 1000-maps_x[prev_wp];
+    double center_y = 2000-maps_y[prev_wp];
+    double centerToPos = distance(center_x,center_y,x_x,x_y);
+    double centerToRef = distance(center_x,center_y,proj_x,proj_y);
+    
+    if(centerToPos <= centerToRef)
+    {
+        frenet_d *= -1;
+    }
+    
+    // calculate s value
+    double frenet_s = maps_cum_s[prev_wp];
+    
+    frenet_s += distance(0,0,proj_x,proj_y);
+    
+    return {frenet_s,frenet_d};
+    
+}
+
+// Transform from Frenet s,d coordinates to Cartesian x,y
+vector<double> getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y)
+{
+    // last waypoint with maps_s < s
+    int prev_wp = lower_bound(maps_s.begin(), maps_s.end(), s) - maps_s.begin() - 1;
+    prev_wp = max(prev_wp, 0);
+    
+    int wp2 = (prev_wp+1)%maps_x.size();
+    
+    double heading = atan2((maps_y[wp2]-maps_y[prev_wp]),(maps_x[wp2]-maps_x[prev_wp]));
+    // the x,y,s along the segment
+    double seg_s = (s-maps_s[prev_wp]);
+    
+    double seg_x = maps_x[prev_wp]+seg_s*cos(heading);
+    double seg_y = maps_y[prev_wp]+seg_s*sin(heading);
+    
+    double perp_heading = heading-pi()/2;
+    
+    double x = seg_x + d*cos(perp_heading);
+    double y = seg_y + d*sin(perp_heading);
+    
+    return {x,y};
+    
+}
+
+// Arc length from the first waypoint to every waypoint, summed along the map
+vector<double> cumulativeDistances(const vector<double> &maps_x, const vector<double> &maps_y)
+{
+    vector<double> maps_cum_s(maps_x.size(), 0.0);
+    
+    for(int i = 1; i < (int)maps_x.size(); i++)
+    {
+        maps_cum_s[i] = maps_cum_s[i-1] + distance(maps_x[i-1],maps_y[i-1],maps_x[i],maps_y[i]);
+    }
+    
+    return maps_cum_s;
+    
+}
+
+// Unit direction of every map segment, from waypoint i to i+1
+void segmentDirections(const vector<double> &maps_x, const vector<double> &maps_y, vector<double> &seg_ux, vector<double> &seg_uy)
+{
+    int n = maps_x.size();
+    seg_ux.resize(n);
+    seg_uy.resize(n);
+    
+    for(int i = 0; i < n; i++)
+    {
+        int next = (i+1)%n;
+        double len = distance(maps_x[i],maps_y[i],maps_x[next],maps_y[next]);
+        seg_ux[i] = (maps_x[next]-maps_x[i])/len;
+        seg_uy[i] = (maps_y[next]-maps_y[i])/len;
+    }
+    
+}
@@ -0,0 +1,45 @@
+//
+//  frenet.hpp
+//  path_planning
+//
+//  Conversions between map (x,y) and Frenet (s,d) coordinates.
+//
+
+#ifndef frenet_hpp
+#define frenet_hpp
+
+#include <math.h>
+#include <vector>
+#include "waypoint_index.hpp"
+
+using namespace std;
+
+// For converting back and forth between radians and degrees.
+constexpr double pi() { return M_PI; }
+inline double deg2rad(double x) { return x * pi() / 180; }
+inline double rad2deg(double x) { return x * 180 / pi(); }
+
+double distance(double x1, double y1, double x2, double y2);
+
+int ClosestWaypoint(double x, double y, const WaypointIndex &index);
+
+int NextWaypoint(double x, double y, double theta, const WaypointIndex &index);
+
+// Transform from Cartesian x,y coordinates to Frenet s,d coordinates
+vector<double> getFrenet(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s, const WaypointIndex &index);
+
+// Frenet s,d of x,y projected onto the map segment ending at waypoint next_wp
+vector<double> getFrenetOnSegment(double x, double y, int next_wp, const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s);
+
+// Transform from Frenet s,d coordinates to Cartesian x,y
+vector<double> getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y);
+
+// Arc length from the first waypoint to every waypoint, summed along the map.
+// Computed once at map load so getFrenet does not walk the map on every call.
+vector<double> cumulativeDistances(const vector<double> &maps_x, const vector<double> &maps_y);
+
+// Unit direction of every map segment, from waypoint i to i+1 (the last one
+// closes the loop back to the first waypoint)
+void segmentDirections(const vector<double> &maps_x, const vector<double> &maps_y, vector<double> &seg_ux, vector<double> &seg_uy);
+
+#endif /* frenet_hpp */
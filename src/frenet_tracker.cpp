@@ -0,0 +1,205 @@
+//
+//  frenet_tracker.cpp
+//  path_planning
+//
+//  Frenet conversion that remembers the last waypoint of every tracked car and
+//  searches outward from it, since cars barely move between telemetry frames.
+//
+
+#include "frenet_tracker.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include "frenet.hpp"
+#include "simd.hpp"
+
+// cars projected per pass of the batch kernel
+static const int BATCH_CHUNK = 64;
+
+// Raw view of the segment tables handed to the batch kernels
+struct SegmentTable {
+    const double *x, *y, *ux, *uy, *cum_s;
+    double max_s, inv_max_s;
+};
+
+typedef void (*ProjectKernel)(const SegmentTable &tab, const int *seg, const double *xs, const double *ys,
+                              const double *vxs, const double *vys, int n,
+                              double *s, double *d, double *s_dot, double *d_dot);
+
+static void project_scalar(const SegmentTable &tab, const int *seg, const double *xs, const double *ys,
+                           const double *vxs, const double *vys, int n,
+                           double *s, double *d, double *s_dot, double *d_dot) {
+    for (int k = 0; k < n; k++) {
+        int i = seg[k];
+        double rx = xs[k] - tab.x[i];
+        double ry = ys[k] - tab.y[i];
+        double frenet_s = tab.cum_s[i] + (rx*tab.ux[i] + ry*tab.uy[i]);
+        s[k] = frenet_s - floor(frenet_s * tab.inv_max_s) * tab.max_s;
+        d[k] = rx*tab.uy[i] - ry*tab.ux[i];
+        s_dot[k] = vxs[k]*tab.ux[i] + vys[k]*tab.uy[i];
+        d_dot[k] = vxs[k]*tab.uy[i] - vys[k]*tab.ux[i];
+    }
+}
+
+#ifdef PATH_PLANNING_X86
+
+__attribute__((target("avx2")))
+static void project_avx2(const SegmentTable &tab, const int *seg, const double *xs, const double *ys,
+                         const double *vxs, const double *vys, int n,
+                         double *s, double *d, double *s_dot, double *d_dot) {
+    const __m256d max_s = _mm256_set1_pd(tab.max_s);
+    const __m256d inv_max_s = _mm256_set1_pd(tab.inv_max_s);
+
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128i i = _mm_loadu_si128((const __m128i *)(seg + k));
+        __m256d px = gather_pd(tab.x, i);
+        __m256d py = gather_pd(tab.y, i);
+        __m256d ux = gather_pd(tab.ux, i);
+        __m256d uy = gather_pd(tab.uy, i);
+        __m256d cum = gather_pd(tab.cum_s, i);
+
+        __m256d rx = _mm256_sub_pd(_mm256_loadu_pd(xs + k), px);
+        __m256d ry = _mm256_sub_pd(_mm256_loadu_pd(ys + k), py);
+        __m256d vx = _mm256_loadu_pd(vxs + k);
+        __m256d vy = _mm256_loadu_pd(vys + k);
+
+        __m256d frenet_s = _mm256_add_pd(cum, _mm256_add_pd(_mm256_mul_pd(rx, ux), _mm256_mul_pd(ry, uy)));
+        frenet_s = _mm256_sub_pd(frenet_s, _mm256_mul_pd(_mm256_floor_pd(_mm256_mul_pd(frenet_s, inv_max_s)), max_s));
+
+        _mm256_storeu_pd(s + k, frenet_s);
+        _mm256_storeu_pd(d + k, _mm256_sub_pd(_mm256_mul_pd(rx, uy), _mm256_mul_pd(ry, ux)));
+        _mm256_storeu_pd(s_dot + k, _mm256_add_pd(_mm256_mul_pd(vx, ux), _mm256_mul_pd(vy, uy)));
+        _mm256_storeu_pd(d_dot + k, _mm256_sub_pd(_mm256_mul_pd(vx, uy), _mm256_mul_pd(vy, ux)));
+    }
+    project_scalar(tab, seg + k, xs + k, ys + k, vxs + k, vys + k, n - k, s + k, d + k, s_dot + k, d_dot + k);
+}
+
+#endif
+
+static ProjectKernel project_kernel() {
+#ifdef PATH_PLANNING_X86
+    if (simd_level() == SIMD_AVX2) {
+        return project_avx2;
+    }
+#endif
+    return project_scalar;
+}
+
+
+FrenetTracker::FrenetTracker(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s, const WaypointIndex &index, double max_s)
+    : maps_x(maps_x), maps_y(maps_y), maps_cum_s(maps_cum_s), index(index), max_s(max_s) {
+    segmentDirections(maps_x, maps_y, seg_ux, seg_uy);
+}
+
+FrenetTracker::FrenetTracker(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s, const WaypointIndex &index, double max_s,
+                             const vector<double> &seg_ux, const vector<double> &seg_uy)
+    : maps_x(maps_x), maps_y(maps_y), maps_cum_s(maps_cum_s), index(index), max_s(max_s), seg_ux(seg_ux), seg_uy(seg_uy) {}
+
+int FrenetTracker::local_search(int wp, double x, double y, double &dist) const {
+    /*
+     Walks from wp towards whichever neighbour is closer to x,y until neither is.
+     Returns -1 if the walk needs more than max_local_steps.
+     */
+    int n = maps_x.size();
+    dist = distance(x, y, maps_x[wp], maps_y[wp]);
+
+    for (int step = 0; step <= max_local_steps; step++) {
+        int ahead = (wp + 1) % n;
+        int behind = (wp + n - 1) % n;
+        double dist_ahead = distance(x, y, maps_x[ahead], maps_y[ahead]);
+        double dist_behind = distance(x, y, maps_x[behind], maps_y[behind]);
+
+        if (dist_ahead < dist && dist_ahead <= dist_behind) {
+            wp = ahead;
+            dist = dist_ahead;
+        } else if (dist_behind < dist) {
+            wp = behind;
+            dist = dist_behind;
+        } else {
+            return wp;
+        }
+    }
+    return -1;
+}
+
+bool FrenetTracker::consistent(int wp, double dist) const {
+    /*
+     A car on the road is never further from its closest waypoint than the longer
+     of the two segments meeting there. Anything else means the local search got
+     stuck on the wrong part of the map.
+     */
+    int n = maps_x.size();
+    int ahead = (wp + 1) % n;
+    int behind = (wp + n - 1) % n;
+    double seg_ahead = distance(maps_x[wp], maps_y[wp], maps_x[ahead], maps_y[ahead]);
+    double seg_behind = distance(maps_x[wp], maps_y[wp], maps_x[behind], maps_y[behind]);
+    return dist <= max(seg_ahead, seg_behind);
+}
+
+int FrenetTracker::closest(int id, double x, double y) {
+
+    unordered_map<int, int>::iterator it = last_wp.find(id);
+    if (it != last_wp.end()) {
+        double dist;
+        int wp = local_search(it->second, x, y, dist);
+        if (wp >= 0 && consistent(wp, dist)) {
+            local_hits++;
+            it->second = wp;
+            return wp;
+        }
+    }
+
+    global_searches++;
+    int wp = index.closest(x, y);
+    last_wp[id] = wp;
+    return wp;
+}
+
+vector<double> FrenetTracker::getFrenet(int id, double x, double y, double theta) {
+
+    int closest_wp = closest(id, x, y);
+    int next_wp = index.next_from(closest_wp, x, y, theta);
+
+    vector<double> frenet = getFrenetOnSegment(x, y, next_wp, maps_x, maps_y, maps_cum_s);
+
+    // the last segment runs past max_s back to the start of the loop
+    frenet[0] = fmod(frenet[0], max_s);
+    if (frenet[0] < 0) {
+        frenet[0] += max_s;
+    }
+    return frenet;
+}
+
+void FrenetTracker::forget(int id) {
+    last_wp.erase(id);
+}
+
+int FrenetTracker::segment(int id, double x, double y) {
+    /*
+     Segment containing the projection of x,y: the one leaving the closest
+     waypoint if the car is past it, else the one arriving at it. Unlike
+     NextWaypoint this needs no heading, so parked cars project correctly too.
+     */
+    int n = maps_x.size();
+    int wp = closest(id, x, y);
+    double along = (x - maps_x[wp])*seg_ux[wp] + (y - maps_y[wp])*seg_uy[wp];
+    return along >= 0 ? wp : (wp + n - 1) % n;
+}
+
+void FrenetTracker::getFrenet(const int *ids, const double *xs, const double *ys, const double *vxs, const double *vys, int n,
+                              double *s, double *d, double *s_dot, double *d_dot) {
+
+    SegmentTable tab = {maps_x.data(), maps_y.data(), seg_ux.data(), seg_uy.data(), maps_cum_s.data(), max_s, 1.0 / max_s};
+    ProjectKernel project = project_kernel();
+
+    int seg[BATCH_CHUNK];
+    for (int begin = 0; begin < n; begin += BATCH_CHUNK) {
+        int count = min(BATCH_CHUNK, n - begin);
+        for (int k = 0; k < count; k++) {
+            seg[k] = segment(ids[begin + k], xs[begin + k], ys[begin + k]);
+        }
+        project(tab, seg, xs + begin, ys + begin, vxs + begin, vys + begin, count,
+                s + begin, d + begin, s_dot + begin, d_dot + begin);
+    }
+}
@@ -0,0 +1,94 @@
+//
+//  frenet_tracker.hpp
+//  path_planning
+//
+//  Frenet conversion that remembers the last waypoint of every tracked car and
+//  searches outward from it, since cars barely move between telemetry frames.
+//
+
+#ifndef frenet_tracker_hpp
+#define frenet_tracker_hpp
+
+#include <unordered_map>
+#include <vector>
+#include "waypoint_index.hpp"
+
+using namespace std;
+
+class FrenetTracker {
+public:
+
+    // id under which the ego car is tracked, as in the predictions map
+    static const int EGO_ID = -1;
+
+    // hill climbing steps allowed before falling back to the global search
+    int max_local_steps = 8;
+
+    // queries answered from the remembered waypoint / through the index
+    long local_hits = 0;
+
+    long global_searches = 0;
+
+    /**
+     * Constructor
+     */
+    FrenetTracker(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s, const WaypointIndex &index, double max_s);
+
+    /**
+     * Same, reusing segment directions precomputed by segmentDirections(),
+     * e.g. the ones stored in a compiled map file.
+     */
+    FrenetTracker(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_cum_s, const WaypointIndex &index, double max_s,
+                  const vector<double> &seg_ux, const vector<double> &seg_uy);
+
+    /**
+     * Frenet s,d of car id at x,y with heading theta. s is wrapped into [0, max_s).
+     */
+    vector<double> getFrenet(int id, double x, double y, double theta);
+
+    /**
+     * Frenet state of n cars at once, e.g. the whole sensor fusion list. Inputs
+     * and outputs are SoA arrays of length n; s_dot and d_dot are the velocity
+     * vx,vy decomposed along and across the road. d is signed towards the map
+     * normal, as the simulator reports it.
+     */
+    void getFrenet(const int *ids, const double *xs, const double *ys, const double *vxs, const double *vys, int n,
+                   double *s, double *d, double *s_dot, double *d_dot);
+
+    /**
+     * Closest waypoint of car id, warm-started from its previous closest waypoint.
+     */
+    int closest(int id, double x, double y);
+
+    /**
+     * Drops the remembered waypoint of a car that left the sensor range.
+     */
+    void forget(int id);
+
+private:
+
+    const vector<double> &maps_x;
+
+    const vector<double> &maps_y;
+
+    const vector<double> &maps_cum_s;
+
+    const WaypointIndex &index;
+
+    double max_s;
+
+    unordered_map<int, int> last_wp;
+
+    // unit direction of the segment from waypoint i to i+1, shared by all cars
+    vector<double> seg_ux;
+
+    vector<double> seg_uy;
+
+    int segment(int id, double x, double y);
+
+    int local_search(int wp, double x, double y, double &dist) const;
+
+    bool consistent(int wp, double dist) const;
+};
+
+#endif /* frenet_tracker_hpp */
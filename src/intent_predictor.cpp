@@ -0,0 +1,160 @@
+//
+//  intent_predictor.cpp
+//  path_planning
+//
+//  Lane-change intent of the sensed cars: a Gaussian naive Bayes classifier
+//  on each car's offset from its lane centre, lateral speed and gap to the
+//  car ahead gives the probability that it keeps its lane or changes left
+//  or right, and every mode gets its own lateral trajectory over the
+//  horizon. All cars are classified in one pass over SoA arrays.
+//
+
+#include "intent_predictor.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+static const double LANE_WIDTH = 4;
+
+// lane offset of every mode
+static const int MODE_DIRECTION[INTENT_MODES] = {0, -1, 1};
+
+// Minimum jerk blend from 0 to 1 over tau in [0, 1]
+static double min_jerk(double tau) {
+    tau = min(1.0, max(0.0, tau));
+    return tau * tau * tau * (10 - 15 * tau + 6 * tau * tau);
+}
+
+IntentPredictor::IntentPredictor() {
+    /* d grows to the right, lane 0 is the leftmost. Offsets and d_dot of a
+       car changing lanes lean the way it goes; a short gap ahead makes a
+       change likelier. */
+    const double defaults_prior[INTENT_MODES] = {0.8, 0.1, 0.1};
+    const double defaults_mean[INTENT_MODES][FEATURES] = {
+        {0.0, 0.0, 60},
+        {-0.6, -0.9, 25},
+        {0.6, 0.9, 25},
+    };
+    const double defaults_sigma[INTENT_MODES][FEATURES] = {
+        {0.5, 0.25, 40},
+        {0.8, 0.5, 25},
+        {0.8, 0.5, 25},
+    };
+    for (int m = 0; m < INTENT_MODES; m++) {
+        prior[m] = defaults_prior[m];
+        for (int f = 0; f < FEATURES; f++) {
+            mean[m][f] = defaults_mean[m][f];
+            sigma[m][f] = defaults_sigma[m][f];
+        }
+    }
+}
+
+int IntentPredictor::road_lane(double d) const {
+    int lane = (int)floor(d / LANE_WIDTH);
+    if (d >= -0.5 * LANE_WIDTH && d < (lanes + 0.5) * LANE_WIDTH) {
+        lane = min(max(lane, 0), lanes - 1);
+    }
+    return lane;
+}
+
+void IntentPredictor::predict(const PredictionTensor &motion, const double *d_dot, IntentPrediction &out) {
+
+    int n = motion.cars;
+    int stride = motion.stride;
+    out.cars = n;
+    out.stride = stride;
+    out.steps = motion.steps;
+    out.dt = motion.dt;
+    out.p.resize(INTENT_MODES * stride);
+    out.lane.resize(INTENT_MODES * stride);
+    out.d.resize(INTENT_MODES * out.rows() * stride);
+
+    const double *s = motion.s_at(0);
+    const double *d = motion.d_at(0);
+
+    /* Log of the prior and of the normalization of every Gaussian, and the
+       inverse standard deviations, once per frame rather than per car. */
+    double log_base[INTENT_MODES];
+    double inv_sigma[INTENT_MODES][FEATURES];
+    for (int m = 0; m < INTENT_MODES; m++) {
+        log_base[m] = log(prior[m]);
+        for (int f = 0; f < FEATURES; f++) {
+            inv_sigma[m][f] = 1 / sigma[m][f];
+            log_base[m] += log(inv_sigma[m][f]);
+        }
+    }
+
+    double *p_keep = out.p.data();
+    double *p_left = p_keep + stride;
+    double *p_right = p_left + stride;
+
+    for (int i = 0; i < n; i++) {
+        int lane = road_lane(d[i]);
+
+        // gap to the nearest car ahead in the same lane
+        double gap = max_gap;
+        for (int j = 0; j < n; j++) {
+            double ahead = s[j] - s[i];
+            if (j != i && ahead > 0 && ahead < gap && road_lane(d[j]) == lane) {
+                gap = ahead;
+            }
+        }
+        double x[FEATURES] = {d[i] - (lane + 0.5) * LANE_WIDTH, d_dot[i], gap};
+
+        double log_p[INTENT_MODES];
+        double best = -HUGE_VAL;
+        for (int m = 0; m < INTENT_MODES; m++) {
+            int target = lane + MODE_DIRECTION[m];
+            out.lane[m * stride + i] = target;
+            if (target < 0 || target >= lanes) {
+                log_p[m] = -HUGE_VAL;
+                continue;
+            }
+            log_p[m] = log_base[m];
+            for (int f = 0; f < FEATURES; f++) {
+                double z = (x[f] - mean[m][f]) * inv_sigma[m][f];
+                log_p[m] -= 0.5 * z * z;
+            }
+            best = max(best, log_p[m]);
+        }
+
+        // normalized in the log domain, so far-off features do not underflow
+        double total = 0;
+        double weight[INTENT_MODES];
+        for (int m = 0; m < INTENT_MODES; m++) {
+            weight[m] = log_p[m] == -HUGE_VAL ? 0 : exp(log_p[m] - best);
+            total += weight[m];
+        }
+        if (total > 0) {
+            p_keep[i] = weight[INTENT_KEEP] / total;
+            p_left[i] = weight[INTENT_LEFT] / total;
+            p_right[i] = weight[INTENT_RIGHT] / total;
+        } else {
+            // more than half a lane off the road: it stays where it is
+            p_keep[i] = 1;
+            p_left[i] = 0;
+            p_right[i] = 0;
+        }
+    }
+    for (int i = n; i < stride; i++) {
+        p_keep[i] = 1;
+        p_left[i] = 0;
+        p_right[i] = 0;
+        for (int m = 0; m < INTENT_MODES; m++) {
+            out.lane[m * stride + i] = 0;
+        }
+    }
+
+    // every mode moves d from the sensed position to its lane centre
+    for (int m = 0; m < INTENT_MODES; m++) {
+        const int *lane = out.lane.data() + m * stride;
+        for (int k = 0; k < out.rows(); k++) {
+            double blend = min_jerk(k * motion.dt / change_time);
+            double *d_row = out.d.data() + (m * out.rows() + k) * stride;
+            for (int i = 0; i < stride; i++) {
+                double centre = (lane[i] + 0.5) * LANE_WIDTH;
+                d_row[i] = d[i] + (centre - d[i]) * blend;
+            }
+        }
+    }
+}
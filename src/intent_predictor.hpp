@@ -0,0 +1,101 @@
+//
+//  intent_predictor.hpp
+//  path_planning
+//
+//  Lane-change intent of the sensed cars: a Gaussian naive Bayes classifier
+//  on each car's offset from its lane centre, lateral speed and gap to the
+//  car ahead gives the probability that it keeps its lane or changes left
+//  or right, and every mode gets its own lateral trajectory over the
+//  horizon. All cars are classified in one pass over SoA arrays.
+//
+
+#ifndef intent_predictor_hpp
+#define intent_predictor_hpp
+
+#include <vector>
+#include "traffic_predictor.hpp"
+
+using namespace std;
+
+enum IntentMode {
+    INTENT_KEEP,
+    INTENT_LEFT,
+    INTENT_RIGHT
+};
+
+static const int INTENT_MODES = 3;
+
+// Probability and lateral trajectory of every car under every mode
+struct IntentPrediction {
+
+    int cars = 0;
+
+    // as in the PredictionTensor the modes were derived from
+    int stride = 0;
+
+    int steps = 0;
+
+    double dt = 0;
+
+    // probability of mode m for car i at [m*stride + i]; the modes sum to 1
+    vector<double> p;
+
+    // lane car i drives in under mode m, at [m*stride + i]
+    vector<int> lane;
+
+    // d of car i under mode m at row k, at [(m*rows() + k)*stride + i]
+    vector<double> d;
+
+    int rows() const { return steps + 1; }
+
+    const double *p_of(IntentMode mode) const { return p.data() + mode * stride; }
+
+    const int *lane_of(IntentMode mode) const { return lane.data() + mode * stride; }
+
+    const double *d_at(IntentMode mode, int row) const { return d.data() + (mode * rows() + row) * stride; }
+};
+
+class IntentPredictor {
+public:
+
+    // features: offset from the lane centre [m], d_dot [m/s], gap ahead [m]
+    static const int FEATURES = 3;
+
+    // the gap feature of a car with nobody ahead
+    double max_gap = 100;
+
+    // class priors, and per class the mean and standard deviation of each feature
+    double prior[INTENT_MODES];
+
+    double mean[INTENT_MODES][FEATURES];
+
+    double sigma[INTENT_MODES][FEATURES];
+
+    // a lane change reaches the next lane centre after this long [s]
+    double change_time = 3.0;
+
+    int lanes = 3;
+
+    /**
+     * Constructor. The defaults describe highway traffic: cars mostly keep
+     * their lane, and the ones changing drift and move towards the new lane,
+     * more often when the car ahead is close.
+     */
+    IntentPredictor();
+
+    /**
+     * Classifies the cars of motion, whose row 0 is the sensed state, given
+     * their lateral speed d_dot, and fills out. Modes leaving the road get
+     * probability 0. Allocates only when out has to grow.
+     */
+    void predict(const PredictionTensor &motion, const double *d_dot, IntentPrediction &out);
+
+    /**
+     * Lane of a car at d. One straddling the edge of the road, within half a
+     * lane of it, counts in the outer lane; one further off keeps its lane
+     * off the road, -1 or lanes and beyond.
+     */
+    int road_lane(double d) const;
+};
+
+#endif /* intent_predictor_hpp */
@@ -0,0 +1,331 @@
+//
+//  kalman_bank.cpp
+//  path_planning
+//
+//  Constant acceleration Kalman filters for every tracked car, along and
+//  across the road: s, s_dot, s_ddot from measured s and s_dot, and d,
+//  d_dot, d_ddot from measured d and d_dot. States and the unique entries of the 3x3
+//  covariances are SoA arrays indexed by tracker slot, and one sweep
+//  predicts and updates every filter at once, vectorized across cars.
+//
+
+#include "kalman_bank.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include "simd.hpp"
+
+// filters per vector of the widest kernel; slots are padded to it
+static const int LANES = 4;
+
+// Raw view of the bank handed to the sweep kernels
+struct KalmanArrays {
+    double *s, *s_dot, *s_ddot, *d, *d_dot, *d_ddot;
+    double *ps00, *ps01, *ps02, *ps11, *ps12, *ps22;
+    double *pd00, *pd01, *pd02, *pd11, *pd12, *pd22;
+    const double *dt, *z_s, *z_v, *z_d, *z_dd, *mask;
+    int size;
+    double jerk_s, jerk_d, var_s, var_v, var_d, var_d_dot;
+    double max_s, inv_max_s;
+};
+
+typedef void (*SweepKernel)(const KalmanArrays &k);
+
+/*
+ Both axes share F = [1 dt dt^2/2; 0 1 dt; 0 0 1] and the white jerk process
+ noise q [dt^5/20 dt^4/8 dt^3/6; dt^4/8 dt^3/3 dt^2/2; dt^3/6 dt^2/2 dt]. The
+ longitudinal filter measures s and s_dot, the lateral one d and d_dot. A slot with no
+ measurement has dt 0 and mask 0, which makes F the identity, Q and the gain
+ zero, and the sweep a no-op for it.
+ */
+static void sweep_scalar(const KalmanArrays &k) {
+    for (int i = 0; i < k.size; i++) {
+        double dt = k.dt[i], m = k.mask[i];
+        double h = 0.5 * dt * dt;
+        double q2 = 0.5 * dt * dt, q3 = dt * dt * dt / 6, q4 = dt * dt * dt * dt / 8;
+        double q3b = dt * dt * dt / 3, q5 = dt * dt * dt * dt * dt / 20;
+
+        /* along the road */
+        double x0 = k.s[i] + dt * k.s_dot[i] + h * k.s_ddot[i];
+        double x1 = k.s_dot[i] + dt * k.s_ddot[i];
+        double x2 = k.s_ddot[i];
+        double a00 = k.ps00[i] + dt * k.ps01[i] + h * k.ps02[i];
+        double a01 = k.ps01[i] + dt * k.ps11[i] + h * k.ps12[i];
+        double a02 = k.ps02[i] + dt * k.ps12[i] + h * k.ps22[i];
+        double a11 = k.ps11[i] + dt * k.ps12[i];
+        double a12 = k.ps12[i] + dt * k.ps22[i];
+        double n00 = a00 + dt * a01 + h * a02 + k.jerk_s * q5;
+        double n01 = a01 + dt * a02 + k.jerk_s * q4;
+        double n02 = a02 + k.jerk_s * q3;
+        double n11 = a11 + dt * a12 + k.jerk_s * q3b;
+        double n12 = a12 + k.jerk_s * q2;
+        double n22 = k.ps22[i] + k.jerk_s * dt;
+
+        double S00 = n00 + k.var_s, S01 = n01, S11 = n11 + k.var_v;
+        double inv_det = m / (S00 * S11 - S01 * S01);
+        double K00 = (n00 * S11 - n01 * S01) * inv_det, K01 = (n01 * S00 - n00 * S01) * inv_det;
+        double K10 = (n01 * S11 - n11 * S01) * inv_det, K11 = (n11 * S00 - n01 * S01) * inv_det;
+        double K20 = (n02 * S11 - n12 * S01) * inv_det, K21 = (n12 * S00 - n02 * S01) * inv_det;
+
+        // s wraps at max_s, so take the shorter way round
+        double y0 = k.z_s[i] - x0;
+        y0 -= nearbyint(y0 * k.inv_max_s) * k.max_s;
+        double y1 = k.z_v[i] - x1;
+
+        x0 += K00 * y0 + K01 * y1;
+        k.s[i] = x0 - floor(x0 * k.inv_max_s) * k.max_s;
+        k.s_dot[i] = x1 + K10 * y0 + K11 * y1;
+        k.s_ddot[i] = x2 + K20 * y0 + K21 * y1;
+        k.ps00[i] = n00 - K00 * n00 - K01 * n01;
+        k.ps01[i] = n01 - K00 * n01 - K01 * n11;
+        k.ps02[i] = n02 - K00 * n02 - K01 * n12;
+        k.ps11[i] = n11 - K10 * n01 - K11 * n11;
+        k.ps12[i] = n12 - K10 * n02 - K11 * n12;
+        k.ps22[i] = n22 - K20 * n02 - K21 * n12;
+
+        /* across the road */
+        x0 = k.d[i] + dt * k.d_dot[i] + h * k.d_ddot[i];
+        x1 = k.d_dot[i] + dt * k.d_ddot[i];
+        x2 = k.d_ddot[i];
+        a00 = k.pd00[i] + dt * k.pd01[i] + h * k.pd02[i];
+        a01 = k.pd01[i] + dt * k.pd11[i] + h * k.pd12[i];
+        a02 = k.pd02[i] + dt * k.pd12[i] + h * k.pd22[i];
+        a11 = k.pd11[i] + dt * k.pd12[i];
+        a12 = k.pd12[i] + dt * k.pd22[i];
+        n00 = a00 + dt * a01 + h * a02 + k.jerk_d * q5;
+        n01 = a01 + dt * a02 + k.jerk_d * q4;
+        n02 = a02 + k.jerk_d * q3;
+        n11 = a11 + dt * a12 + k.jerk_d * q3b;
+        n12 = a12 + k.jerk_d * q2;
+        n22 = k.pd22[i] + k.jerk_d * dt;
+
+        S00 = n00 + k.var_d, S01 = n01, S11 = n11 + k.var_d_dot;
+        inv_det = m / (S00 * S11 - S01 * S01);
+        K00 = (n00 * S11 - n01 * S01) * inv_det, K01 = (n01 * S00 - n00 * S01) * inv_det;
+        K10 = (n01 * S11 - n11 * S01) * inv_det, K11 = (n11 * S00 - n01 * S01) * inv_det;
+        K20 = (n02 * S11 - n12 * S01) * inv_det, K21 = (n12 * S00 - n02 * S01) * inv_det;
+
+        y0 = k.z_d[i] - x0;
+        y1 = k.z_dd[i] - x1;
+
+        k.d[i] = x0 + K00 * y0 + K01 * y1;
+        k.d_dot[i] = x1 + K10 * y0 + K11 * y1;
+        k.d_ddot[i] = x2 + K20 * y0 + K21 * y1;
+        k.pd00[i] = n00 - K00 * n00 - K01 * n01;
+        k.pd01[i] = n01 - K00 * n01 - K01 * n11;
+        k.pd02[i] = n02 - K00 * n02 - K01 * n12;
+        k.pd11[i] = n11 - K10 * n01 - K11 * n11;
+        k.pd12[i] = n12 - K10 * n02 - K11 * n12;
+        k.pd22[i] = n22 - K20 * n02 - K21 * n12;
+    }
+}
+
+#ifdef PATH_PLANNING_X86
+
+// a * b + c
+__attribute__((target("avx2")))
+static inline __m256d madd(__m256d a, __m256d b, __m256d c) {
+    return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+}
+
+// c - a * b
+__attribute__((target("avx2")))
+static inline __m256d msub(__m256d a, __m256d b, __m256d c) {
+    return _mm256_sub_pd(c, _mm256_mul_pd(a, b));
+}
+
+__attribute__((target("avx2")))
+static void sweep_avx2(const KalmanArrays &k) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d sixth = _mm256_set1_pd(1.0 / 6);
+    const __m256d third = _mm256_set1_pd(1.0 / 3);
+    const __m256d eighth = _mm256_set1_pd(0.125);
+    const __m256d twentieth = _mm256_set1_pd(0.05);
+    const __m256d jerk_s = _mm256_set1_pd(k.jerk_s);
+    const __m256d jerk_d = _mm256_set1_pd(k.jerk_d);
+    const __m256d var_s = _mm256_set1_pd(k.var_s);
+    const __m256d var_v = _mm256_set1_pd(k.var_v);
+    const __m256d var_d = _mm256_set1_pd(k.var_d);
+    const __m256d var_d_dot = _mm256_set1_pd(k.var_d_dot);
+    const __m256d max_s = _mm256_set1_pd(k.max_s);
+    const __m256d inv_max_s = _mm256_set1_pd(k.inv_max_s);
+
+    for (int i = 0; i < k.size; i += LANES) {
+        __m256d dt = _mm256_loadu_pd(k.dt + i);
+        __m256d m = _mm256_loadu_pd(k.mask + i);
+        __m256d dt2 = _mm256_mul_pd(dt, dt);
+        __m256d dt3 = _mm256_mul_pd(dt2, dt);
+        __m256d dt4 = _mm256_mul_pd(dt3, dt);
+        __m256d h = _mm256_mul_pd(half, dt2);
+        __m256d q2 = h;
+        __m256d q3 = _mm256_mul_pd(sixth, dt3);
+        __m256d q3b = _mm256_mul_pd(third, dt3);
+        __m256d q4 = _mm256_mul_pd(eighth, dt4);
+        __m256d q5 = _mm256_mul_pd(twentieth, _mm256_mul_pd(dt4, dt));
+
+        /* along the road */
+        __m256d p00 = _mm256_loadu_pd(k.ps00 + i), p01 = _mm256_loadu_pd(k.ps01 + i);
+        __m256d p02 = _mm256_loadu_pd(k.ps02 + i), p11 = _mm256_loadu_pd(k.ps11 + i);
+        __m256d p12 = _mm256_loadu_pd(k.ps12 + i), p22 = _mm256_loadu_pd(k.ps22 + i);
+        __m256d s = _mm256_loadu_pd(k.s + i);
+        __m256d v = _mm256_loadu_pd(k.s_dot + i);
+        __m256d a = _mm256_loadu_pd(k.s_ddot + i);
+
+        __m256d x0 = madd(h, a, madd(dt, v, s));
+        __m256d x1 = madd(dt, a, v);
+        __m256d x2 = a;
+        __m256d a00 = madd(h, p02, madd(dt, p01, p00));
+        __m256d a01 = madd(h, p12, madd(dt, p11, p01));
+        __m256d a02 = madd(h, p22, madd(dt, p12, p02));
+        __m256d a11 = madd(dt, p12, p11);
+        __m256d a12 = madd(dt, p22, p12);
+        __m256d n00 = madd(jerk_s, q5, madd(h, a02, madd(dt, a01, a00)));
+        __m256d n01 = madd(jerk_s, q4, madd(dt, a02, a01));
+        __m256d n02 = madd(jerk_s, q3, a02);
+        __m256d n11 = madd(jerk_s, q3b, madd(dt, a12, a11));
+        __m256d n12 = madd(jerk_s, q2, a12);
+        __m256d n22 = madd(jerk_s, dt, p22);
+
+        __m256d S00 = _mm256_add_pd(n00, var_s), S01 = n01, S11 = _mm256_add_pd(n11, var_v);
+        __m256d inv_det = _mm256_div_pd(m, msub(S01, S01, _mm256_mul_pd(S00, S11)));
+        __m256d K00 = _mm256_mul_pd(msub(n01, S01, _mm256_mul_pd(n00, S11)), inv_det);
+        __m256d K01 = _mm256_mul_pd(msub(n00, S01, _mm256_mul_pd(n01, S00)), inv_det);
+        __m256d K10 = _mm256_mul_pd(msub(n11, S01, _mm256_mul_pd(n01, S11)), inv_det);
+        __m256d K11 = _mm256_mul_pd(msub(n01, S01, _mm256_mul_pd(n11, S00)), inv_det);
+        __m256d K20 = _mm256_mul_pd(msub(n12, S01, _mm256_mul_pd(n02, S11)), inv_det);
+        __m256d K21 = _mm256_mul_pd(msub(n02, S01, _mm256_mul_pd(n12, S00)), inv_det);
+
+        __m256d y0 = _mm256_sub_pd(_mm256_loadu_pd(k.z_s + i), x0);
+        __m256d laps = _mm256_round_pd(_mm256_mul_pd(y0, inv_max_s), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        y0 = msub(laps, max_s, y0);
+        __m256d y1 = _mm256_sub_pd(_mm256_loadu_pd(k.z_v + i), x1);
+
+        x0 = madd(K01, y1, madd(K00, y0, x0));
+        x0 = msub(_mm256_floor_pd(_mm256_mul_pd(x0, inv_max_s)), max_s, x0);
+        _mm256_storeu_pd(k.s + i, x0);
+        _mm256_storeu_pd(k.s_dot + i, madd(K11, y1, madd(K10, y0, x1)));
+        _mm256_storeu_pd(k.s_ddot + i, madd(K21, y1, madd(K20, y0, x2)));
+        _mm256_storeu_pd(k.ps00 + i, msub(K01, n01, msub(K00, n00, n00)));
+        _mm256_storeu_pd(k.ps01 + i, msub(K01, n11, msub(K00, n01, n01)));
+        _mm256_storeu_pd(k.ps02 + i, msub(K01, n12, msub(K00, n02, n02)));
+        _mm256_storeu_pd(k.ps11 + i, msub(K11, n11, msub(K10, n01, n11)));
+        _mm256_storeu_pd(k.ps12 + i, msub(K11, n12, msub(K10, n02, n12)));
+        _mm256_storeu_pd(k.ps22 + i, msub(K21, n12, msub(K20, n02, n22)));
+
+        /* across the road */
+        p00 = _mm256_loadu_pd(k.pd00 + i), p01 = _mm256_loadu_pd(k.pd01 + i);
+        p02 = _mm256_loadu_pd(k.pd02 + i), p11 = _mm256_loadu_pd(k.pd11 + i);
+        p12 = _mm256_loadu_pd(k.pd12 + i), p22 = _mm256_loadu_pd(k.pd22 + i);
+        s = _mm256_loadu_pd(k.d + i);
+        v = _mm256_loadu_pd(k.d_dot + i);
+        a = _mm256_loadu_pd(k.d_ddot + i);
+
+        x0 = madd(h, a, madd(dt, v, s));
+        x1 = madd(dt, a, v);
+        x2 = a;
+        a00 = madd(h, p02, madd(dt, p01, p00));
+        a01 = madd(h, p12, madd(dt, p11, p01));
+        a02 = madd(h, p22, madd(dt, p12, p02));
+        a11 = madd(dt, p12, p11);
+        a12 = madd(dt, p22, p12);
+        n00 = madd(jerk_d, q5, madd(h, a02, madd(dt, a01, a00)));
+        n01 = madd(jerk_d, q4, madd(dt, a02, a01));
+        n02 = madd(jerk_d, q3, a02);
+        n11 = madd(jerk_d, q3b, madd(dt, a12, a11));
+        n12 = madd(jerk_d, q2, a12);
+        n22 = madd(jerk_d, dt, p22);
+
+        S00 = _mm256_add_pd(n00, var_d), S01 = n01, S11 = _mm256_add_pd(n11, var_d_dot);
+        inv_det = _mm256_div_pd(m, msub(S01, S01, _mm256_mul_pd(S00, S11)));
+        K00 = _mm256_mul_pd(msub(n01, S01, _mm256_mul_pd(n00, S11)), inv_det);
+        K01 = _mm256_mul_pd(msub(n00, S01, _mm256_mul_pd(n01, S00)), inv_det);
+        K10 = _mm256_mul_pd(msub(n11, S01, _mm256_mul_pd(n01, S11)), inv_det);
+        K11 = _mm256_mul_pd(msub(n01, S01, _mm256_mul_pd(n11, S00)), inv_det);
+        K20 = _mm256_mul_pd(msub(n12, S01, _mm256_mul_pd(n02, S11)), inv_det);
+        K21 = _mm256_mul_pd(msub(n02, S01, _mm256_mul_pd(n12, S00)), inv_det);
+
+        y0 = _mm256_sub_pd(_mm256_loadu_pd(k.z_d + i), x0);
+        y1 = _mm256_sub_pd(_mm256_loadu_pd(k.z_dd + i), x1);
+
+        _mm256_storeu_pd(k.d + i, madd(K01, y1, madd(K00, y0, x0)));
+        _mm256_storeu_pd(k.d_dot + i, madd(K11, y1, madd(K10, y0, x1)));
+        _mm256_storeu_pd(k.d_ddot + i, madd(K21, y1, madd(K20, y0, x2)));
+        _mm256_storeu_pd(k.pd00 + i, msub(K01, n01, msub(K00, n00, n00)));
+        _mm256_storeu_pd(k.pd01 + i, msub(K01, n11, msub(K00, n01, n01)));
+        _mm256_storeu_pd(k.pd02 + i, msub(K01, n12, msub(K00, n02, n02)));
+        _mm256_storeu_pd(k.pd11 + i, msub(K11, n11, msub(K10, n01, n11)));
+        _mm256_storeu_pd(k.pd12 + i, msub(K11, n12, msub(K10, n02, n12)));
+        _mm256_storeu_pd(k.pd22 + i, msub(K21, n12, msub(K20, n02, n22)));
+    }
+}
+
+#endif
+
+static SweepKernel sweep_kernel() {
+#ifdef PATH_PLANNING_X86
+    if (simd_level() == SIMD_AVX2) {
+        return sweep_avx2;
+    }
+#endif
+    return sweep_scalar;
+}
+
+KalmanBank::KalmanBank(int capacity) {
+    size = (capacity + LANES - 1) / LANES * LANES;
+    for (vector<double> *column : {&s, &s_dot, &s_ddot, &d, &d_dot, &d_ddot,
+                                   &ps00, &ps01, &ps02, &ps11, &ps12, &ps22,
+                                   &pd00, &pd01, &pd02, &pd11, &pd12, &pd22,
+                                   &dt, &z_s, &z_v, &z_d, &z_dd, &mask}) {
+        column->assign(size, 0.0);
+    }
+}
+
+void KalmanBank::init(int slot, double s, double s_dot, double d, double d_dot) {
+    this->s[slot] = s;
+    this->s_dot[slot] = s_dot;
+    this->s_ddot[slot] = 0;
+    this->d[slot] = d;
+    this->d_dot[slot] = d_dot;
+    this->d_ddot[slot] = 0;
+    ps00[slot] = var_s;
+    ps11[slot] = var_v;
+    ps22[slot] = init_var_a;
+    ps01[slot] = ps02[slot] = ps12[slot] = 0;
+    pd00[slot] = var_d;
+    pd11[slot] = var_d_dot;
+    pd22[slot] = init_var_a;
+    pd01[slot] = pd02[slot] = pd12[slot] = 0;
+    dt[slot] = 0;
+    mask[slot] = 0;
+}
+
+void KalmanBank::measure(int slot, double dt, double s, double s_dot, double d, double d_dot) {
+    this->dt[slot] = dt;
+    z_s[slot] = s;
+    z_v[slot] = s_dot;
+    z_d[slot] = d;
+    z_dd[slot] = d_dot;
+    mask[slot] = 1;
+}
+
+void KalmanBank::step(double max_s) {
+    KalmanArrays k;
+    k.s = s.data(); k.s_dot = s_dot.data(); k.s_ddot = s_ddot.data();
+    k.d = d.data(); k.d_dot = d_dot.data(); k.d_ddot = d_ddot.data();
+    k.ps00 = ps00.data(); k.ps01 = ps01.data(); k.ps02 = ps02.data();
+    k.ps11 = ps11.data(); k.ps12 = ps12.data(); k.ps22 = ps22.data();
+    k.pd00 = pd00.data(); k.pd01 = pd01.data(); k.pd02 = pd02.data();
+    k.pd11 = pd11.data(); k.pd12 = pd12.data(); k.pd22 = pd22.data();
+    k.dt = dt.data(); k.z_s = z_s.data(); k.z_v = z_v.data(); k.z_d = z_d.data(); k.z_dd = z_dd.data(); k.mask = mask.data();
+    k.size = size;
+    k.jerk_s = jerk_s; k.jerk_d = jerk_d;
+    k.var_s = var_s; k.var_v = var_v; k.var_d = var_d; k.var_d_dot = var_d_dot;
+    k.max_s = max_s;
+    k.inv_max_s = max_s > 0 ? 1 / max_s : 0;
+
+    sweep_kernel()(k);
+
+    // measurements are used once
+    fill(dt.begin(), dt.end(), 0.0);
+    fill(mask.begin(), mask.end(), 0.0);
+}
@@ -0,0 +1,81 @@
+//
+//  kalman_bank.hpp
+//  path_planning
+//
+//  Constant acceleration Kalman filters for every tracked car, along and
+//  across the road: s, s_dot, s_ddot from measured s and s_dot, and d,
+//  d_dot, d_ddot from measured d and d_dot. States and the unique entries of the 3x3
+//  covariances are SoA arrays indexed by tracker slot, and one sweep
+//  predicts and updates every filter at once, vectorized across cars.
+//
+
+#ifndef kalman_bank_hpp
+#define kalman_bank_hpp
+
+#include <vector>
+
+using namespace std;
+
+class KalmanBank {
+public:
+
+    // process noise: spectral density of the jerk along / across the road
+    double jerk_s = 4;
+
+    double jerk_d = 1;
+
+    // measurement variances of s [m^2], s_dot [m^2/s^2], d [m^2] and d_dot [m^2/s^2]
+    double var_s = 0.25;
+
+    double var_v = 0.25;
+
+    double var_d = 0.04;
+
+    double var_d_dot = 0.25;
+
+    // initial variance of the unmeasured accelerations
+    double init_var_a = 9;
+
+    // filtered state per slot
+    vector<double> s, s_dot, s_ddot;
+
+    vector<double> d, d_dot, d_ddot;
+
+    /**
+     * Constructor. Filters for capacity slots.
+     */
+    KalmanBank(int capacity);
+
+    /**
+     * Restarts the filter of slot at a first measurement, with no
+     * acceleration.
+     */
+    void init(int slot, double s, double s_dot, double d, double d_dot);
+
+    /**
+     * Queues a measurement of slot taken dt seconds after its last one, for
+     * the next step().
+     */
+    void measure(int slot, double dt, double s, double s_dot, double d, double d_dot);
+
+    /**
+     * Predicts every filter with a queued measurement to it and updates it;
+     * the others stay as they are. s wraps into [0, max_s) unless max_s is 0.
+     */
+    void step(double max_s);
+
+private:
+
+    // capacity rounded up to a whole vector
+    int size;
+
+    // covariances, upper triangle
+    vector<double> ps00, ps01, ps02, ps11, ps12, ps22;
+
+    vector<double> pd00, pd01, pd02, pd11, pd12, pd22;
+
+    // queued measurements; mask is 1 where one is queued, dt 0 elsewhere
+    vector<double> dt, z_s, z_v, z_d, z_dd, mask;
+};
+
+#endif /* kalman_bank_hpp */
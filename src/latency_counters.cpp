@@ -0,0 +1,63 @@
+//
+//  latency_counters.cpp
+//  path_planning
+//
+//  Per-listener frame latency: count, mean, maximum and a power-of-two
+//  histogram for percentiles. Safe to record from any thread.
+//
+
+#include "latency_counters.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+
+
+LatencyCounters::LatencyCounters(const string &name) : name(name) {
+    reset();
+}
+
+void LatencyCounters::record(long ns) {
+    frames.fetch_add(1, memory_order_relaxed);
+    total_ns.fetch_add(ns, memory_order_relaxed);
+    long seen = max_ns.load(memory_order_relaxed);
+    while (ns > seen && !max_ns.compare_exchange_weak(seen, ns, memory_order_relaxed)) {
+    }
+    /* Bucket i counts samples of at most 2^i us, as Prometheus' le reads:
+       whole microseconds rounded up, then the smallest power of two not
+       below them. */
+    long us = (ns + 999) / 1000;
+    int bucket = us <= 1 ? 0 : min(64 - __builtin_clzl((unsigned long)(us - 1)), BUCKETS - 1);
+    buckets[bucket].fetch_add(1, memory_order_relaxed);
+}
+
+double LatencyCounters::percentile(double q) const {
+    long n = frames.load(memory_order_relaxed);
+    // no bucket bound beyond the slowest frame seen
+    double max_us = max_ns.load(memory_order_relaxed) / 1000.0;
+    long seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen > 0 && seen >= q * n) {
+            return min((double)(1L << i), max_us);
+        }
+    }
+    return max_us;
+}
+
+string LatencyCounters::report() const {
+    long n = frames.load(memory_order_relaxed);
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %ld frames, mean %.1f us, p50 <= %.0f us, p99 <= %.0f us, max %.1f us",
+             name.c_str(), n, n ? total_ns.load() / 1000.0 / n : 0.0, percentile(0.5), percentile(0.99),
+             max_ns.load() / 1000.0);
+    return line;
+}
+
+void LatencyCounters::reset() {
+    frames = 0;
+    total_ns = 0;
+    max_ns = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+}
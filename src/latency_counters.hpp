@@ -0,0 +1,52 @@
+//
+//  latency_counters.hpp
+//  path_planning
+//
+//  Per-listener frame latency: count, mean, maximum and a power-of-two
+//  histogram for percentiles. Safe to record from any thread.
+//
+
+#ifndef latency_counters_hpp
+#define latency_counters_hpp
+
+#include <atomic>
+#include <string>
+
+using namespace std;
+
+class LatencyCounters {
+public:
+
+    // histogram buckets: [0, 1] us, (1, 2] us, (2, 4] us, ... up to about 17 s
+    static const int BUCKETS = 25;
+
+    atomic<long> frames;
+
+    atomic<long> total_ns;
+
+    atomic<long> max_ns;
+
+    atomic<long> buckets[BUCKETS];
+
+    /**
+     * Constructor. name labels the report, e.g. "tcp".
+     */
+    LatencyCounters(const string &name);
+
+    void record(long ns);
+
+    /**
+     * Upper bound of the bucket holding quantile q (0 to 1) of the frames, capped
+     * at the maximum [us].
+     */
+    double percentile(double q) const;
+
+    // one line: name, frames, mean, p50, p99, max
+    string report() const;
+
+    void reset();
+
+    const string name;
+};
+
+#endif /* latency_counters_hpp */
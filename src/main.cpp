@@ -1,17 +1,31 @@
 #include <fstream>
 #include <math.h>
 #include <uWS/uWS.h>
+#include <uv.h>
+#include <algorithm>
+#include <functional>
 #include <chrono>
 #include <iostream>
 #include <thread>
+#include <mutex>
+#include <memory>
+#include <pthread.h>
 #include <vector>
 #include <map>
 #include "Eigen-3.3/Eigen/Core"
 #include "Eigen-3.3/Eigen/QR"
 #include "Eigen-3.3/Eigen/Dense"
-#include "json.hpp"
-#include "spline.h"
-#include "vehicle.hpp"
+#include "road_map.hpp"
+#include "planner.hpp"
+#include "telemetry.hpp"
+#include "control_writer.hpp"
+#include "binary_protocol.hpp"
+#include "shm_channel.hpp"
+#include "unix_listener.hpp"
+#include "latency_counters.hpp"
+#include "planner_session.hpp"
+#include "planning_worker.hpp"
+#include "metrics_exporter.hpp"
 
 
 
@@ -20,162 +34,6 @@ using namespace std;
 using Eigen::MatrixXd;
 using Eigen::VectorXd;
 
-// for convenience
-using json = nlohmann::json;
-
-// For converting back and forth between radians and degrees.
-constexpr double pi() { return M_PI; }
-double deg2rad(double x) { return x * pi() / 180; }
-double rad2deg(double x) { return x * 180 / pi(); }
-
-// Checks if the SocketIO event has JSON data.
-// If there is data the JSON object in string format will be returned,
-// else the empty string "" will be returned.
-string hasData(string s)
-{
-    auto found_null = s.find("null");
-    auto b1 = s.find_first_of("[");
-    auto b2 = s.find_first_of("}");
-    if (found_null != string::npos) {
-        return "";
-    } else if (b1 != string::npos && b2 != string::npos) {
-        return s.substr(b1, b2 - b1 + 2);
-    }
-    return "";
-}
-
-double distance(double x1, double y1, double x2, double y2)
-{
-    return sqrt((x2-x1)*(x2-x1)+(y2-y1)*(y2-y1));
-}
-int ClosestWaypoint(double x, double y, const vector<double> &maps_x, const vector<double> &maps_y)
-{
-    
-    double closestLen = 100000; //large number
-    int closestWaypoint = 0;
-    
-    for(int i = 0; i < maps_x.size(); i++)
-    {
-        double map_x = maps_x[i];
-        double map_y = maps_y[i];
-        double dist = distance(x,y,map_x,map_y);
-        if(dist < closestLen)
-        {
-            closestLen = dist;
-            closestWaypoint = i;
-        }
-        
-    }
-    
-    return closestWaypoint;
-    
-}
-
-int NextWaypoint(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y)
-{
-    
-    int closestWaypoint = ClosestWaypoint(x,y,maps_x,maps_y);
-    
-    double map_x = maps_x[closestWaypoint];
-    double map_y = maps_y[closestWaypoint];
-    
-    double heading = atan2( (map_y-y),(map_x-x) );
-    
-    double angle = abs(theta-heading);
-    
-    angle = min(2*pi() - angle, angle);
-    
-    if(angle > pi()/4)
-    {
-        closestWaypoint++;
-        
-        if (closestWaypoint == maps_x.size())
-        {
-            closestWaypoint = 0;
-        }
-    }
-    
-    return closestWaypoint;
-    
-}
-
-// Transform from Cartesian x,y coordinates to Frenet s,d coordinates
-vector<double> getFrenet(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y)
-{
-    int next_wp = NextWaypoint(x,y, theta, maps_x,maps_y);
-    
-    int prev_wp;
-    prev_wp = next_wp-1;
-    if(next_wp == 0)
-    {
-        prev_wp  = maps_x.size()-1;
-    }
-    
-    double n_x = maps_x[next_wp]-maps_x[prev_wp];
-    double n_y = maps_y[next_wp]-maps_y[prev_wp];
-    double x_x = x - maps_x[prev_wp];
-    double x_y = y - maps_y[prev_wp];
-    
-    // find the projection of x onto n
-    double proj_norm = (x_x*n_x+x_y*n_y)/(n_x*n_x+n_y*n_y);
-    double proj_x = proj_norm*n_x;
-    double proj_y = proj_norm*n_y;
-    
-    double frenet_d = distance(x_x,x_y,proj_x,proj_y);
-    
-    //see if d value is positive or negative by comparing it to a center point
-    
-    double center_x = 1000-maps_x[prev_wp];
-    double center_y = 2000-maps_y[prev_wp];
-    double centerToPos = distance(center_x,center_y,x_x,x_y);
-    double centerToRef = distance(center_x,center_y,proj_x,proj_y);
-    
-    if(centerToPos <= centerToRef)
-    {
-        frenet_d *= -1;
-    }
-    
-    // calculate s value
-    double frenet_s = 0;
-    for(int i = 0; i < prev_wp; i++)
-    {
-        frenet_s += distance(maps_x[i],maps_y[i],maps_x[i+1],maps_y[i+1]);
-    }
-    
-    frenet_s += distance(0,0,proj_x,proj_y);
-    
-    return {frenet_s,frenet_d};
-    
-}
-
-// Transform from Frenet s,d coordinates to Cartesian x,y
-vector<double> getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y)
-{
-    int prev_wp = -1;
-    
-    while(s > maps_s[prev_wp+1] && (prev_wp < (int)(maps_s.size()-1) ))
-    {
-        prev_wp++;
-    }
-    
-    int wp2 = (prev_wp+1)%maps_x.size();
-    
-    double heading = atan2((maps_y[wp2]-maps_y[prev_wp]),(maps_x[wp2]-maps_x[prev_wp]));
-    // the x,y,s along the segment
-    double seg_s = (s-maps_s[prev_wp]);
-    
-    double seg_x = maps_x[prev_wp]+seg_s*cos(heading);
-    double seg_y = maps_y[prev_wp]+seg_s*sin(heading);
-    
-    double perp_heading = heading-pi()/2;
-    
-    double x = seg_x + d*cos(perp_heading);
-    double y = seg_y + d*sin(perp_heading);
-    
-    return {x,y};
-    
-}
-
 // TODO - complete this function
 vector<double> JMT(vector< double> start, vector <double> end, double T)
 {
@@ -228,355 +86,104 @@ vector<double> JMT(vector< double> start, vector <double> end, double T)
 }
 
 
-int main() {
-    uWS::Hub h;
-    
-    // Load up map values for waypoint's x,y,s and d normalized normal vectors
-    vector<double> map_waypoints_x;
-    vector<double> map_waypoints_y;
-    vector<double> map_waypoints_s;
-    vector<double> map_waypoints_dx;
-    vector<double> map_waypoints_dy;
-    
-    // Waypoint map to read from
-    string map_file_ = "../data/highway_map.csv";
-    // The max s value before wrapping around the track back to 0
-    double max_s = 6945.554;
-    float max_acc = 10;
-    double dt = .02; //s
-    double ref_vel = 0.0; //mph
-    int lane = 1;
-    
-    
-    Vehicle ego = Vehicle(lane,0, 0, 0, 0);
-    ego.configure(max_s, max_acc,0);
-    
-    
-    ifstream in_map_(map_file_.c_str(), ifstream::in);
-    
-    string line;
-    while (getline(in_map_, line)) {
-        istringstream iss(line);
-        double x;
-        double y;
-        float s;
-        float d_x;
-        float d_y;
-        iss >> x;
-        iss >> y;
-        iss >> s;
-        iss >> d_x;
-        iss >> d_y;
-        map_waypoints_x.push_back(x);
-        map_waypoints_y.push_back(y);
-        map_waypoints_s.push_back(s);
-        map_waypoints_dx.push_back(d_x);
-        map_waypoints_dy.push_back(d_y);
+// Sends the reply the worker left in the session, on the listener thread
+static void deliver(PlannerSession &session, PipelineStats &stats)
+{
+    auto start = chrono::steady_clock::now();
+    stats.handback.record(chrono::duration_cast<chrono::nanoseconds>(start - session.planned).count());
+    if (session.reply.length) {
+        session.send(session.reply);
+        auto sent = chrono::steady_clock::now();
+        stats.send.record(chrono::duration_cast<chrono::nanoseconds>(sent - start).count());
+        stats.total.record(chrono::duration_cast<chrono::nanoseconds>(sent - session.arrival).count());
     }
-    
-    h.onMessage([&map_waypoints_x,&map_waypoints_y,&map_waypoints_s,&map_waypoints_dx,&map_waypoints_dy,&dt,&lane,&ref_vel,&ego](uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length,
-                                                                                                                            uWS::OpCode opCode) {
-        // "42" at the start of the message means there's a websocket message event.
-        // The 4 signifies a websocket message
-        // The 2 signifies a websocket event
-        //auto sdata = string(data).substr(0, length);
-        //cout << sdata << endl;
-        if (length && length > 2 && data[0] == '4' && data[1] == '2') {
-            
-            auto s = hasData(data);
-            
-            if (s != "") {
-                auto j = json::parse(s);
-                
-                string event = j[0].get<string>();
-                
-                if (event == "telemetry") {
-                    // j[1] is the data JSON object
-                    
-                    // Main car's localization Data
-                    double car_x = j[1]["x"];
-                    double car_y = j[1]["y"];
-                    double car_s = j[1]["s"];
-                    double car_d = j[1]["d"];
-                    double car_yaw = j[1]["yaw"];
-                    double car_speed = j[1]["speed"];
-                    
-                    //parameters
-                    int horizon = 40;
-                    double target_x = 25;
-                    float interval = 1.2;
-                    
-                    // update car parameters with measurement
-                    ego.s = car_s;
-                    ego.d = car_d;
-                    ego.v = car_speed/2.24; // [m/s]
-                    
-                    
-                    
-                    // Previous path data given to the Planner
-                    auto previous_path_x = j[1]["previous_path_x"];
-                    auto previous_path_y = j[1]["previous_path_y"];
-                    // Previous path's end s and d values
-                    double end_path_s = j[1]["end_path_s"];
-                    double end_path_d = j[1]["end_path_d"];
-                    
-                    // Sensor Fusion Data, a list of all other cars on the same side of the road.
-                    auto sensor_fusion = j[1]["sensor_fusion"];
-                    
-                    json msgJson;
-                    
-                    int prev_size = previous_path_x.size();
-                    
-                    ego.prev_points = prev_size;
-                    
-                    if (prev_size > 0){
-                        car_s = end_path_s;
-                    }
-                    
-                    bool too_close = false;
-                    
-                    map<int,vector<Vehicle>> predictions;
-                    
-                    for(int i = 0; i < sensor_fusion.size();i++){
-                        float d = sensor_fusion[i][6];
-                        double vx = sensor_fusion[i][3];
-                        double vy = sensor_fusion[i][4];
-                        double check_speed = sqrt(vx*vx+vy*vy);
-                        double check_car_s = sensor_fusion[i][5];
-                        if ( (d < 2+ 4*lane +2) && ( d > 2+ 4*lane-2)){
-                            check_car_s += (double)prev_size*dt*check_speed;
-                            
-                            // check s value greater than mine and s gap
-                            if((check_car_s > car_s) && ((check_car_s-car_s) < 30) ){
-                                // decrease velocity, maybe change lane
-                                //ref_vel = 29.5;
-                                too_close = true;
-                            }
-                        }
-                        int id = sensor_fusion[i][0];
-                        int check_lane = floor(d/4);
-                        //cout <<" d is "<< d;
-                        //cout <<" lane is "<< check_lane<<endl;
-                        //if( (0 <= check_lane) && (check_lane<=2)){
-                            //cout<<"car id "<<id<<" lane "<<check_lane<<" speed "<<check_speed<<endl;
-                            Vehicle car_on_road = Vehicle(check_lane, sensor_fusion[i][5],d, check_speed, 0);
-                            
-                            car_on_road.dt = interval;
-                            car_on_road.configure(6945.554, 10,check_lane);
-                            vector<Vehicle>  pred = car_on_road.generate_predictions(2);
-                        //cout<<"prediction id"<< id <<" lane "<<pred[0].lane<<" speed "<<pred[0].v<<endl;
-                        
-                        predictions[id] =pred ;
-                        //}
-                    }
-                    // ego predictions
-                    //predictions[-1] = ego.generate_predictions();
-                    ego.dt = interval;
-                    vector<Vehicle> trajectory =  ego.choose_next_state(predictions);
-                    ego.realize_next_state(trajectory);
-                    cout<<"-----------------"<<endl;
-                    cout<<"next state "<<ego.state<<endl;
-                    cout<<"next lane "<<ego.lane<<endl;
-                    // set the predicted lane as from fsm
-                    bool adapt_speed = false;
-                    if(abs(lane-ego.lane)>0 && (ego.v < ref_vel)){
-                        adapt_speed = true;
-                    }
-
-                    //keep lane if no improvement in velocity
-                    if (abs(ego.v*2.4 - car_speed) > 0.3){
-                        lane = ego.lane;
-                    }else{
-                        cout<<"keeping lane"<<endl;
-                    }
-                    
-
-                    vector<double> next_x_vals;
-                    vector<double> next_y_vals;
-                    
-                    
-                    // waypoints that serve as reference points to the trajectory
-                    vector<double> ptsx;
-                    vector<double> ptsy;
-                    
-                    double ref_x = car_x;
-                    double ref_y = car_y;
-                    double ref_yaw = deg2rad(car_yaw);
-                    
-                    if (prev_size < 2)
-                    {
-                        //Use two points that make the path tangent to the car
-                        double prev_car_x = ref_x - cos(car_yaw);
-                        double prev_car_y = ref_y - sin(car_yaw);
-                        
-                        ptsx.push_back(prev_car_x);
-                        ptsx.push_back(car_x);
-                        
-                        ptsy.push_back(prev_car_y);
-                        ptsy.push_back(car_y);
-                        
-                    }
-                    // use the prevous path's end point as starting reference
-                    else
-                    {
-                        //Redefine reference state as previous path end point
-                        ref_x = previous_path_x[prev_size-1];
-                        ref_y = previous_path_y[prev_size-1];
-                        
-                        double ref_x_prev = previous_path_x[prev_size-2];
-                        double ref_y_prev = previous_path_y[prev_size-2];
-                        ref_yaw = atan2(ref_y-ref_y_prev, ref_x-ref_x_prev);
-                        
-                        ptsx.push_back(ref_x_prev);
-                        ptsx.push_back(ref_x);
-                        
-                        ptsy.push_back(ref_y_prev);
-                        ptsy.push_back(ref_y);
-                    }
-                    
-                    int size_pts = ptsx.size();
-                    
-                    vector<double> next_wp0 = getXY(car_s+45, 2+(4*lane), map_waypoints_s, map_waypoints_x, map_waypoints_y);
-                    vector<double> next_wp1 = getXY(car_s+50, 2+(4*lane), map_waypoints_s, map_waypoints_x, map_waypoints_y);
-                    vector<double> next_wp2 = getXY(car_s+55, 2+(4*lane), map_waypoints_s, map_waypoints_x, map_waypoints_y);
-                    
-                    
-                    ptsx.push_back(next_wp0[0]);
-                    ptsx.push_back(next_wp1[0]);
-                    ptsx.push_back(next_wp2[0]);
-                    
-                    
-                    ptsy.push_back(next_wp0[1]);
-                    ptsy.push_back(next_wp1[1]);
-                    ptsy.push_back(next_wp2[1]);
-                    
-                    
-                    // change into car coordinate system
-                    for(int i = 0; i < ptsx.size();i++)
-                    {
-                        double shift_x = ptsx[i] - ref_x;
-                        double shift_y = ptsy[i] - ref_y;
-                        
-                        ptsx[i] = shift_x * cos(0-ref_yaw) - shift_y * sin(0-ref_yaw);
-                        ptsy[i] = shift_x * sin(0-ref_yaw) + shift_y * cos(0-ref_yaw);
-                        //cout<<"ptsx "<< ptsx[i] <<endl;
-                    }
-                    
-                    // create a spline
-                    tk::spline s;
-                    
-                    // set points to spline
-                    s.set_points(ptsx,ptsy);
-                    
-                    
-                    
-                    int no_points = previous_path_x.size();
-                    
-                    //no_points = min(no_points,3);
-                    
-
-                    //calculate how to break up target speed
-                    
-                    double target_y = s(target_x);
-                    double target_dist = sqrt((target_x*target_x)+(target_y*target_y));
-                    
-                    // Fill up the rest of the path planner
-                    double x_add_on = 0;
-                    
-                   
-                    
-                    double ego_v = ego.v*2.24;
-                    cout<<"ego speed "<<ego_v<<endl;
-                    /*if ( ego_v < 49.5 && (abs(car_speed-ego_v)/dt<.224)){
-                        
-                         cout<<"keeping veloicty"<<endl;
-                        ref_vel = ego_v;
-                        too_close = true;
-                        
-                    }*/
-                    
-                    // Start with all the previuos path points
-                    for(int i = 0; i< no_points; i++)
-                    {
-                        next_x_vals.push_back(previous_path_x[i]);
-                        next_y_vals.push_back(previous_path_y[i]);
-                    }
-                    
-
-                   
-
-                    /*if (( ego.state.compare("PLCR") == 0 || ego.state.compare("PLCL") == 0) && ref_vel <ego_v)
-                        adapt_speed = true;
-
-                    double needed_acc = (ref_vel-car_speed)/dt;
-                    
-                    if (needed_acc > 0.224 && car_speed > 49 && car_speed < 49.5){
-                        cout<<"exceeding acceleration!!!"<<endl;
-                        //adapt_speed = true;
-                        ref_vel = car_speed;
-                    }*/
+}
 
-                    
-                    for( int i = 0; i< horizon  - no_points;i++){
-                        
-                        if (too_close || adapt_speed){
-                            ref_vel -= .224/2;
-                        }else if(ref_vel < 49.5  && (ref_vel < ego_v)){
-                            ref_vel += .224;
+// Hands a session with a frame waiting to the worker, or plans it right here
+// when the worker is that far behind
+static void dispatch(PlannerSession *session, PlanningWorker &worker, PipelineStats &stats)
+{
+    session->in_flight = true;
+    if (!worker.submit(session)) {
+        session->plan(stats);
+        session->in_flight = false;
+        deliver(*session, stats);
+    }
+}
 
-                        }
+// Sends every reply the worker finished, on the listener thread. Sessions
+// that disconnected while planning are deleted; those that got a newer frame
+// meanwhile go straight back.
+static void collect(PlanningWorker &worker, PipelineStats &stats)
+{
+    PlannerSession *session;
+    while ((session = worker.finished()) != nullptr) {
+        session->in_flight = false;
+        if (session->closed) {
+            delete session;
+            continue;
+        }
+        deliver(*session, stats);
+        if (session->waiting()) {
+            dispatch(session, worker, stats);
+        }
+    }
+}
 
-                        // d = v*dt*N
-                        double N = (target_dist/(0.02 * ref_vel/2.24));
-                        
+// Called on disconnection: a session the worker still holds is deleted when
+// it comes back, see collect()
+static void release(PlannerSession *session)
+{
+    if (session == nullptr) {
+        return;
+    }
+    if (session->in_flight) {
+        session->closed = true;
+    } else {
+        delete session;
+    }
+}
 
-                        double x_point = x_add_on + (target_x/N);
-                        double y_point = s(x_point);
-                        
-                        x_add_on = x_point;
-                        
-                        //cout <<"i "<< i <<" val "<< x_point <<endl;
-                        
-                        double x_ref = x_point;
-                        double y_ref = y_point;
-                        
-                        //rotate from car cs into global cs
-                        x_point = x_ref*cos(ref_yaw)-y_ref*sin(ref_yaw);
-                        y_point = x_ref*sin(ref_yaw)+y_ref*cos(ref_yaw);
-                        
-                        //shift
-                        x_point += ref_x;
-                        y_point += ref_y;
-                        
-                        next_x_vals.push_back(x_point);
-                        next_y_vals.push_back(y_point);
-                    }
-                    
-                    
-                    msgJson["next_x"] = next_x_vals;
-                    msgJson["next_y"] = next_y_vals;
-                    
-                    auto msg = "42[\"control\","+ msgJson.dump()+"]";
-                    
-                    //this_thread::sleep_for(chrono::milliseconds(1000));
-                    ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
-                    
-                }
-            } else {
-                // Manual driving
-                std::string msg = "42[\"manual\",{}]";
-                ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
-            }
+// Runs one event loop on the calling thread: a hub of its own listening on
+// port, serving the sessions the kernel hands to it. Returns false if it
+// cannot listen, and does not return otherwise. metrics is served on
+// /metrics.
+bool run_hub(int port, int listen_options, const RoadMap &road, int control_precision, PipelineStats &stats,
+             const MetricsExporter &metrics)
+{
+    uWS::Hub h;
+    
+    /* The loop only reads and decodes. Every session with a new frame goes to
+       the worker thread, which plans and writes the reply and wakes the loop
+       through done_async to send it. A frame arriving while its session is
+       with the worker replaces any older one still waiting, so frames queued
+       behind a slow plan are skipped, not planned one after the other. */
+    function<void()> on_done;
+    uv_async_t done_async;
+    done_async.data = &on_done;
+    uv_async_init(h.getLoop(), &done_async, [](uv_async_t *handle) {
+        (*(function<void()> *)handle->data)();
+    });
+    PlanningWorker worker(stats, [&done_async]() { uv_async_send(&done_async); });
+    on_done = [&worker,&stats]() { collect(worker, stats); };
+    worker.start();
+    
+    h.onMessage([&stats,&worker](uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length,
+                                 uWS::OpCode opCode) {
+        PlannerSession *session = (PlannerSession *)ws.getUserData();
+        if (session == nullptr) {
+            return;
+        }
+        if (session->ingest(data, length, opCode == uWS::OpCode::BINARY, stats)) {
+            dispatch(session, worker, stats);
         }
     });
     
-    // We don't need this since we're not using HTTP but if it's removed the
-    // program
-    // doesn't compile :-(
-    h.onHttpRequest([](uWS::HttpResponse *res, uWS::HttpRequest req, char *data,
-                       size_t, size_t) {
-        const std::string s = "<h1>Hello world!</h1>";
-        if (req.getUrl().valueLength == 1) {
+    // Prometheus scrapes every listener's counters from any of the loops
+    h.onHttpRequest([&metrics](uWS::HttpResponse *res, uWS::HttpRequest req, char *data,
+                               size_t, size_t) {
+        if (req.getUrl().toString() == "/metrics") {
+            const std::string s = metrics.render();
             res->end(s.data(), s.length());
         } else {
             // i guess this should be done more gracefully?
@@ -584,22 +191,246 @@ int main() {
         }
     });
     
-    h.onConnection([&h](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
-        std::cout << "Connected!!!" << std::endl;
+    h.onConnection([&h,&road,&control_precision,&stats](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
+        uWS::Header protocol = req.getHeader("sec-websocket-protocol");
+        PlannerSession *session = new PlannerSession(road, control_precision, protocol ? protocol.toString() : string());
+        session->send = [ws](const Reply &reply) mutable {
+            ws.send(reply.data, reply.length, reply.binary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT);
+        };
+        ws.setUserData(session);
+        stats.sessions++;
+        std::cout << "Connected!!! " << stats.total.name << (session->binary ? " (binary)" : "") << std::endl;
     });
     
-    h.onDisconnection([&h](uWS::WebSocket<uWS::SERVER> ws, int code,
+    h.onDisconnection([&h,&stats](uWS::WebSocket<uWS::SERVER> ws, int code,
                            char *message, size_t length) {
+        if (ws.getUserData() != nullptr) {
+            stats.sessions--;
+        }
+        release((PlannerSession *)ws.getUserData());
+        ws.setUserData(nullptr);
         ws.close();
         std::cout << "Disconnected" << std::endl;
+        std::cout << stats.report() << std::endl;
     });
     
-    int port = 4567;
-    if (h.listen(port)) {
-        std::cout << "Listening to port " << port << std::endl;
+    if (h.listen(port, nullptr, listen_options)) {
+        std::cout << "Listening to port " << port << " on " << stats.total.name << std::endl;
     } else {
         std::cerr << "Failed to listen to port" << std::endl;
-        return -1;
+        return false;
     }
     h.run();
+    return true;
+}
+
+// Keeps the calling thread on one core, so every event loop has its own
+static void pin_to_core(int core)
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core % thread::hardware_concurrency(), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+    (void)core;
+#endif
+}
+
+// Plans every binary telemetry frame arriving on the channel's telemetry ring
+// and answers on its control ring. Runs until the process is stopped.
+void serve_shm(ShmChannel &channel, Planner &planner)
+{
+    TelemetryFrame frame;
+    BinaryControlWriter control_writer;
+    vector<double> next_x_vals;
+    vector<double> next_y_vals;
+    
+    while (true) {
+        size_t length;
+        const char *data = channel.telemetry.read(length, -1);
+        if (data == nullptr) {
+            continue;
+        }
+        uint32_t sequence;
+        TelemetryStatus status = decode_binary_telemetry(data, length, frame, sequence);
+        channel.telemetry.release();
+        if (status != TELEMETRY_OK) {
+            std::cerr << "Dropped malformed shared memory telemetry" << std::endl;
+            continue;
+        }
+        
+        if (!planner.sync_path(frame)) {
+            frame.path_size = 0;
+            planner.rebuild_path(frame);
+        }
+        planner.plan(frame, next_x_vals, next_y_vals);
+        
+        control_writer.write(next_x_vals.data(), next_y_vals.data(), next_x_vals.size(), sequence);
+        if (!channel.control.write(control_writer.data(), control_writer.size())) {
+            // the client stopped reading; it starts over from an empty path
+            planner.reset();
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    
+    // --tiled-map: read the compiled map in s tiles loaded around the ego
+    // instead of holding the whole route, for maps too long to keep resident;
+    // every session keeps its own window of tiles
+    bool use_tiled_map = false;
+    // --precision N: send path coordinates with N decimals instead of the
+    // shortest round-trip digits, for a smaller control message
+    int control_precision = ControlWriter::SHORTEST;
+    // --shm NAME: serve a simulator on this host through the shared memory
+    // channel NAME (e.g. /path_planning) instead of the websocket
+    string shm_name;
+    // --unix PATH: serve the websocket protocol on the AF_UNIX socket PATH as
+    // well as on the TCP port
+    string unix_path;
+    // --threads N: spread simulator connections over N event loops, one per
+    // core, all listening on the TCP port
+    int hub_threads = 1;
+    // --verbose: print every frame's behaviour decision, as the original
+    // planner did; it serializes the planning threads on stdout
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--tiled-map") {
+            use_tiled_map = true;
+        } else if (string(argv[i]) == "--precision" && i + 1 < argc) {
+            control_precision = atoi(argv[++i]);
+        } else if (string(argv[i]) == "--shm" && i + 1 < argc) {
+            shm_name = argv[++i];
+        } else if (string(argv[i]) == "--unix" && i + 1 < argc) {
+            unix_path = argv[++i];
+        } else if (string(argv[i]) == "--threads" && i + 1 < argc) {
+            hub_threads = max(1, atoi(argv[++i]));
+        } else if (string(argv[i]) == "--verbose") {
+            Vehicle::verbose = true;
+        }
+    }
+    
+    // Waypoint map to read from. The compiled map (see map_compiler) is mmapped
+    // when present, the csv is parsed otherwise.
+    string map_file_ = "../data/highway_map.csv";
+    string map_bin_ = "../data/highway_map.bin";
+    
+    RoadMap road;
+    if (use_tiled_map) {
+        if (road.use_tiles(map_bin_)) {
+            std::cout << "Tiled " << map_bin_ << ", " << road.tiles->tile_count() << " tiles" << std::endl;
+        } else {
+            std::cerr << "Failed to open " << map_bin_ << " as a tiled map, loading it whole" << std::endl;
+        }
+    }
+    if (!road.tiles) {
+        if (!road.load(map_bin_, map_file_)) {
+            std::cerr << "Failed to read " << map_file_ << std::endl;
+            return -1;
+        }
+        if (road.mapped()) {
+            std::cout << "Mapped " << map_bin_ << std::endl;
+        }
+    }
+    
+    if (!shm_name.empty()) {
+        Planner planner(road);
+        ShmChannel channel;
+        if (!channel.create(shm_name)) {
+            std::cerr << "Failed to create shared memory channel " << shm_name << std::endl;
+            return -1;
+        }
+        std::cout << "Serving shared memory channel " << shm_name << std::endl;
+        serve_shm(channel, planner);
+        return 0;
+    }
+    
+    UnixListener unix_listener;
+    PipelineStats unix_stats("unix");
+    PlanningWorker unix_worker(unix_stats, [&unix_listener]() { unix_listener.wake(); });
+    if (!unix_path.empty()) {
+        unix_listener.on_connection([&road,&control_precision,&unix_stats](UnixConnection &connection, const string &protocol) {
+            PlannerSession *session = new PlannerSession(road, control_precision, protocol);
+            session->send = [&connection](const Reply &reply) {
+                connection.send(reply.data, reply.length, reply.binary);
+            };
+            connection.user = session;
+            unix_stats.sessions++;
+            std::cout << "Connected on unix socket" << (session->binary ? " (binary)" : "") << std::endl;
+            return string(session->binary ? BINARY_PROTOCOL : "");
+        });
+        unix_listener.on_message([&unix_stats,&unix_worker](UnixConnection &connection, char *data, size_t length, bool binary) {
+            PlannerSession *session = (PlannerSession *)connection.user;
+            if (session->ingest(data, length, binary, unix_stats)) {
+                dispatch(session, unix_worker, unix_stats);
+            }
+        });
+        unix_listener.on_wake([&unix_stats,&unix_worker]() {
+            collect(unix_worker, unix_stats);
+        });
+        unix_listener.on_disconnection([&unix_stats](UnixConnection &connection) {
+            release((PlannerSession *)connection.user);
+            connection.user = nullptr;
+            unix_stats.sessions--;
+            std::cout << "Disconnected from unix socket" << std::endl;
+            std::cout << unix_stats.report() << std::endl;
+        });
+        if (unix_listener.listen(unix_path)) {
+            unix_worker.start();
+            unix_listener.start();
+            std::cout << "Listening to " << unix_path << std::endl;
+        } else {
+            std::cerr << "Failed to listen to " << unix_path << std::endl;
+            return -1;
+        }
+    }
+    
+    /* One event loop per thread, each with its own hub on the same port: with
+       SO_REUSEPORT the kernel spreads new connections over them. Sessions never
+       leave their loop; only the road map is shared, read-only. */
+    int port = 4567;
+    int listen_options = hub_threads > 1 ? uS::ListenOptions::REUSE_PORT : 0;
+    vector<unique_ptr<PipelineStats>> hub_stats;
+    for (int i = 0; i < hub_threads; i++) {
+        hub_stats.emplace_back(new PipelineStats("tcp " + to_string(i)));
+    }
+    MetricsExporter metrics;
+    for (auto &stats : hub_stats) {
+        metrics.add(*stats);
+    }
+    if (!unix_path.empty()) {
+        metrics.add(unix_stats);
+    }
+    for (int i = 1; i < hub_threads; i++) {
+        thread([i,port,listen_options,&road,control_precision,&hub_stats,&metrics] {
+            pin_to_core(i);
+            run_hub(port, listen_options, road, control_precision, *hub_stats[i], metrics);
+        }).detach();
+    }
+    
+    // frames per second of every event loop, i.e. per core, every 10 s
+    if (hub_threads > 1) {
+        thread([&hub_stats] {
+            vector<long> last(hub_stats.size(), 0);
+            while (true) {
+                this_thread::sleep_for(chrono::seconds(10));
+                string line = "frames/s per core:";
+                long total = 0;
+                for (size_t i = 0; i < hub_stats.size(); i++) {
+                    long frames = hub_stats[i]->total.frames.load();
+                    line += " " + to_string((frames - last[i]) / 10);
+                    total += frames - last[i];
+                    last[i] = frames;
+                }
+                if (total > 0) {
+                    std::cout << line << ", total " << total / 10 << std::endl;
+                }
+            }
+        }).detach();
+    }
+    
+    pin_to_core(0);
+    if (!run_hub(port, listen_options, road, control_precision, *hub_stats[0], metrics)) {
+        return -1;
+    }
 }
@@ -0,0 +1,67 @@
+//
+//  map_compiler.cpp
+//  path_planning
+//
+//  Compiles a waypoint csv into the binary map file mmapped by the planner:
+//
+//      map_compiler <highway_map.csv> <highway_map.bin> [max_s] [line_step]
+//
+
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+#include "frenet.hpp"
+#include "map_file.hpp"
+#include "reference_line.hpp"
+
+using namespace std;
+
+
+int main(int argc, char **argv) {
+
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " <map.csv> <map.bin> [max_s] [line_step]" << endl;
+        return 1;
+    }
+
+    string csv_file = argv[1];
+    string bin_file = argv[2];
+    // The max s value before wrapping around the track back to 0
+    double max_s = argc > 3 ? atof(argv[3]) : 6945.554;
+    double line_step = argc > 4 ? atof(argv[4]) : 0.25;
+
+    vector<double> maps_x, maps_y, maps_s, maps_dx, maps_dy;
+    if (!read_map_csv(csv_file, maps_x, maps_y, maps_s, maps_dx, maps_dy) || maps_x.size() < 2) {
+        cerr << "cannot read waypoints from " << csv_file << endl;
+        return 1;
+    }
+
+    vector<double> maps_cum_s = cumulativeDistances(maps_x, maps_y);
+    vector<double> seg_ux, seg_uy;
+    segmentDirections(maps_x, maps_y, seg_ux, seg_uy);
+    ReferenceLine ref_line(maps_x, maps_y, maps_s, maps_dx, maps_dy, max_s, line_step);
+
+    MapFileHeader header = MapFileHeader();
+    header.waypoints = maps_x.size();
+    header.line_samples = ref_line.size() + 1;
+    header.max_s = max_s;
+    header.line_step = ref_line.step();
+
+    const double *sections[MAP_SECTION_COUNT] = {
+        maps_x.data(), maps_y.data(), maps_s.data(), maps_dx.data(), maps_dy.data(),
+        maps_cum_s.data(), seg_ux.data(), seg_uy.data(),
+        ref_line.x, ref_line.y, ref_line.cos_heading, ref_line.sin_heading, ref_line.nx, ref_line.ny
+    };
+    for (int i = 0; i < MAP_SECTION_COUNT; i++) {
+        header.count[i] = i < LINE_X ? header.waypoints : header.line_samples;
+    }
+
+    if (!write_map_file(bin_file, header, sections)) {
+        cerr << "cannot write " << bin_file << endl;
+        return 1;
+    }
+
+    cout << "compiled " << header.waypoints << " waypoints and " << header.line_samples
+         << " reference line samples into " << bin_file << endl;
+    return 0;
+}
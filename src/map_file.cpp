@@ -0,0 +1,163 @@
+//
+//  map_file.cpp
+//  path_planning
+//
+//  Compiled binary map: the waypoints of highway_map.csv plus the tables
+//  derived from them, laid out so the planner can mmap the file read-only
+//  instead of parsing text at startup.
+//
+
+#include "map_file.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const char MAP_FILE_MAGIC[8] = {'P', 'P', 'M', 'A', 'P', 'B', 'I', 'N'};
+
+static const uint32_t MAP_FILE_BYTE_ORDER = 0x01020304;
+
+static uint64_t page_align(uint64_t offset) {
+    return (offset + MAP_FILE_PAGE - 1) / MAP_FILE_PAGE * MAP_FILE_PAGE;
+}
+
+bool read_map_csv(const string &path, vector<double> &maps_x, vector<double> &maps_y, vector<double> &maps_s,
+                  vector<double> &maps_dx, vector<double> &maps_dy) {
+
+    ifstream in_map_(path.c_str(), ifstream::in);
+    if (!in_map_) {
+        return false;
+    }
+
+    string line;
+    while (getline(in_map_, line)) {
+        istringstream iss(line);
+        double x;
+        double y;
+        double s;
+        double d_x;
+        double d_y;
+        if (!(iss >> x >> y >> s >> d_x >> d_y)) {
+            continue;
+        }
+        maps_x.push_back(x);
+        maps_y.push_back(y);
+        maps_s.push_back(s);
+        maps_dx.push_back(d_x);
+        maps_dy.push_back(d_y);
+    }
+    return true;
+}
+
+bool write_map_file(const string &path, MapFileHeader header, const double *const sections[MAP_SECTION_COUNT]) {
+
+    memcpy(header.magic, MAP_FILE_MAGIC, sizeof(header.magic));
+    header.version = MAP_FILE_VERSION;
+    header.byte_order = MAP_FILE_BYTE_ORDER;
+
+    uint64_t offset = page_align(sizeof(MapFileHeader));
+    for (int i = 0; i < MAP_SECTION_COUNT; i++) {
+        header.offset[i] = offset;
+        offset = page_align(offset + header.count[i] * sizeof(double));
+    }
+
+    ofstream out(path.c_str(), ofstream::binary | ofstream::trunc);
+    if (!out) {
+        return false;
+    }
+
+    vector<char> padding(MAP_FILE_PAGE, 0);
+    out.write((const char *)&header, sizeof(header));
+    uint64_t written = sizeof(header);
+    for (int i = 0; i < MAP_SECTION_COUNT; i++) {
+        out.write(&padding[0], header.offset[i] - written);
+        out.write((const char *)sections[i], header.count[i] * sizeof(double));
+        written = header.offset[i] + header.count[i] * sizeof(double);
+    }
+    out.write(&padding[0], offset - written);
+
+    return (bool)out;
+}
+
+bool valid_map_header(const MapFileHeader &h, size_t file_length) {
+
+    bool valid = memcmp(h.magic, MAP_FILE_MAGIC, sizeof(h.magic)) == 0
+              && h.version == MAP_FILE_VERSION
+              && h.byte_order == MAP_FILE_BYTE_ORDER;
+    for (int i = 0; valid && i < MAP_SECTION_COUNT; i++) {
+        uint64_t expected = i < LINE_X ? h.waypoints : h.line_samples;
+        valid = h.count[i] == expected
+             && h.offset[i] % MAP_FILE_PAGE == 0
+             && h.offset[i] + h.count[i] * sizeof(double) <= file_length;
+    }
+    return valid && h.waypoints > 1 && h.line_samples > 1 && h.max_s > 0;
+}
+
+MappedMap::MappedMap() {}
+
+MappedMap::~MappedMap() {
+    close();
+}
+
+bool MappedMap::open(const string &path) {
+
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MapFileHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    base = mapped;
+    length = st.st_size;
+
+    if (!valid_map_header(header(), length)) {
+        close();
+        return false;
+    }
+
+    // the planner touches the whole map within the first lap
+    madvise(base, length, MADV_WILLNEED);
+    return true;
+}
+
+void MappedMap::close() {
+    if (base) {
+        munmap(base, length);
+        base = nullptr;
+        length = 0;
+    }
+}
+
+bool MappedMap::is_open() const {
+    return base != nullptr;
+}
+
+const MapFileHeader &MappedMap::header() const {
+    return *(const MapFileHeader *)base;
+}
+
+const double *MappedMap::section(MapSection section) const {
+    return (const double *)((const char *)base + header().offset[section]);
+}
+
+size_t MappedMap::count(MapSection section) const {
+    return header().count[section];
+}
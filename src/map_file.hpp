@@ -0,0 +1,117 @@
+//
+//  map_file.hpp
+//  path_planning
+//
+//  Compiled binary map: the waypoints of highway_map.csv plus the tables
+//  derived from them, laid out so the planner can mmap the file read-only
+//  instead of parsing text at startup.
+//
+
+#ifndef map_file_hpp
+#define map_file_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Every section of the file is a double array starting on a page boundary.
+enum MapSection {
+    MAP_X,          // waypoint x
+    MAP_Y,          // waypoint y
+    MAP_S,          // waypoint s
+    MAP_DX,         // waypoint normal x
+    MAP_DY,         // waypoint normal y
+    MAP_CUM_S,      // arc length up to the waypoint, see cumulativeDistances()
+    MAP_SEG_UX,     // unit direction of the segment leaving the waypoint
+    MAP_SEG_UY,
+    LINE_X,         // reference line samples, see ReferenceLine
+    LINE_Y,
+    LINE_COS_HEADING,
+    LINE_SIN_HEADING,
+    LINE_NX,
+    LINE_NY,
+    MAP_SECTION_COUNT
+};
+
+const uint32_t MAP_FILE_VERSION = 1;
+
+const uint64_t MAP_FILE_PAGE = 4096;
+
+struct MapFileHeader {
+    char magic[8];              // "PPMAPBIN"
+    uint32_t version;           // MAP_FILE_VERSION
+    uint32_t byte_order;        // 0x01020304 as written by the compiling machine
+    uint64_t waypoints;
+    uint64_t line_samples;      // reference line samples per array, closing sample included
+    double max_s;
+    double line_step;
+    uint64_t offset[MAP_SECTION_COUNT];
+    uint64_t count[MAP_SECTION_COUNT];
+};
+
+/**
+ * Reads the whitespace separated x y s dx dy rows of a waypoint csv. All
+ * columns are parsed as double. Returns false if the file cannot be read.
+ */
+bool read_map_csv(const string &path, vector<double> &maps_x, vector<double> &maps_y, vector<double> &maps_s,
+                  vector<double> &maps_dx, vector<double> &maps_dy);
+
+/**
+ * Writes a compiled map file. The caller fills in the sizes, max_s, line_step
+ * and count of every section; magic, version and offsets are set here.
+ * Sections are arrays indexed by MapSection. Returns false on I/O errors.
+ */
+bool write_map_file(const string &path, MapFileHeader header, const double *const sections[MAP_SECTION_COUNT]);
+
+/**
+ * Checks magic, version, byte order and that every section lies page-aligned
+ * within a file of file_length bytes.
+ */
+bool valid_map_header(const MapFileHeader &header, size_t file_length);
+
+/**
+ * Read-only mapping of a compiled map file, shareable between processes.
+ */
+class MappedMap {
+public:
+
+    /**
+     * Constructor
+     */
+    MappedMap();
+
+    /**
+     * Destructor
+     */
+    virtual ~MappedMap();
+
+    MappedMap(const MappedMap &) = delete;
+    MappedMap &operator=(const MappedMap &) = delete;
+
+    /**
+     * Maps path and validates its header. Returns false and stays closed if
+     * the file is missing, truncated or from another version or byte order.
+     */
+    bool open(const string &path);
+
+    void close();
+
+    bool is_open() const;
+
+    const MapFileHeader &header() const;
+
+    const double *section(MapSection section) const;
+
+    size_t count(MapSection section) const;
+
+private:
+
+    void *base = nullptr;
+
+    size_t length = 0;
+};
+
+#endif /* map_file_hpp */
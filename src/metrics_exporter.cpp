@@ -0,0 +1,119 @@
+//
+//  metrics_exporter.cpp
+//  path_planning
+//
+//  Renders the pipeline counters of every listener as Prometheus text for
+//  the /metrics endpoint. Rendering only loads the counters' atomics, so a
+//  scrape never blocks or slows a planning thread.
+//
+
+#include "metrics_exporter.hpp"
+
+#include <stdio.h>
+
+
+// Appends one histogram series from the power-of-two microsecond buckets
+static void append_histogram(string &out, const char *metric, const string &labels, const LatencyCounters &counters) {
+    char line[256];
+    long seen = 0;
+    for (int i = 0; i < LatencyCounters::BUCKETS; i++) {
+        seen += counters.buckets[i].load(memory_order_relaxed);
+        if (i < LatencyCounters::BUCKETS - 1) {
+            snprintf(line, sizeof(line), "%s_bucket{%s,le=\"%g\"} %ld\n", metric, labels.c_str(),
+                     (1L << i) * 1e-6, seen);
+        } else {
+            snprintf(line, sizeof(line), "%s_bucket{%s,le=\"+Inf\"} %ld\n", metric, labels.c_str(), seen);
+        }
+        out += line;
+    }
+    /* count from the buckets just read, not frames, so it matches +Inf even
+       while a worker is recording */
+    snprintf(line, sizeof(line), "%s_sum{%s} %.9f\n%s_count{%s} %ld\n", metric, labels.c_str(),
+             counters.total_ns.load(memory_order_relaxed) * 1e-9, metric, labels.c_str(), seen);
+    out += line;
+}
+
+static void append_header(string &out, const char *metric, const char *type, const char *help) {
+    out += string("# HELP ") + metric + " " + help + "\n# TYPE " + metric + " " + type + "\n";
+}
+
+static void append_value(string &out, const char *metric, const string &labels, double value) {
+    char line[256];
+    snprintf(line, sizeof(line), "%s{%s} %.10g\n", metric, labels.c_str(), value);
+    out += line;
+}
+
+void MetricsExporter::add(const PipelineStats &stats) {
+    listeners.push_back(&stats);
+}
+
+string MetricsExporter::render() const {
+
+    string out;
+
+    append_header(out, "path_planning_stage_seconds", "histogram", "Time frames spent in each stage of the pipeline.");
+    for (const PipelineStats *stats : listeners) {
+        string listener = "listener=\"" + stats->total.name + "\",stage=";
+        const struct {
+            const char *stage;
+            const LatencyCounters &counters;
+        } stages[] = {
+            {"parse", stats->decode},
+            {"queue", stats->ingest.queue_delay},
+            {"predict", stats->predict},
+            {"decide", stats->decide},
+            {"generate", stats->generate},
+            {"serialize", stats->serialize},
+            {"handback", stats->handback},
+            {"send", stats->send},
+        };
+        for (const auto &stage : stages) {
+            append_histogram(out, "path_planning_stage_seconds", listener + "\"" + stage.stage + "\"", stage.counters);
+        }
+    }
+
+    append_header(out, "path_planning_frame_seconds", "histogram", "Time from telemetry arriving to its path being sent.");
+    for (const PipelineStats *stats : listeners) {
+        append_histogram(out, "path_planning_frame_seconds", "listener=\"" + stats->total.name + "\"", stats->total);
+    }
+
+    append_header(out, "path_planning_frames_received_total", "counter", "Telemetry frames decoded.");
+    for (const PipelineStats *stats : listeners) {
+        append_value(out, "path_planning_frames_received_total", "listener=\"" + stats->total.name + "\"",
+                     stats->ingest.received.load(memory_order_relaxed));
+    }
+
+    append_header(out, "path_planning_frames_processed_total", "counter", "Frames planned and answered.");
+    for (const PipelineStats *stats : listeners) {
+        append_value(out, "path_planning_frames_processed_total", "listener=\"" + stats->total.name + "\"",
+                     stats->total.frames.load(memory_order_relaxed));
+    }
+
+    append_header(out, "path_planning_frames_dropped_total", "counter",
+                  "Frames superseded by a newer one before they were planned.");
+    for (const PipelineStats *stats : listeners) {
+        append_value(out, "path_planning_frames_dropped_total", "listener=\"" + stats->total.name + "\"",
+                     stats->ingest.dropped.load(memory_order_relaxed));
+    }
+
+    append_header(out, "path_planning_allocations_total", "counter", "Heap allocations while planning and serializing.");
+    for (const PipelineStats *stats : listeners) {
+        append_value(out, "path_planning_allocations_total", "listener=\"" + stats->total.name + "\"",
+                     stats->allocations.load(memory_order_relaxed));
+    }
+
+    append_header(out, "path_planning_allocations_per_frame", "gauge", "Mean heap allocations per frame planned.");
+    for (const PipelineStats *stats : listeners) {
+        long planned = stats->plan.frames.load(memory_order_relaxed);
+        append_value(out, "path_planning_allocations_per_frame", "listener=\"" + stats->total.name + "\"",
+                     planned ? (double)stats->allocations.load(memory_order_relaxed) / planned : 0.0);
+    }
+
+    append_header(out, "path_planning_sessions", "gauge", "Simulator connections open.");
+    for (const PipelineStats *stats : listeners) {
+        append_value(out, "path_planning_sessions", "listener=\"" + stats->total.name + "\"",
+                     stats->sessions.load(memory_order_relaxed));
+    }
+
+    return out;
+}
@@ -0,0 +1,36 @@
+//
+//  metrics_exporter.hpp
+//  path_planning
+//
+//  Renders the pipeline counters of every listener as Prometheus text for
+//  the /metrics endpoint. Rendering only loads the counters' atomics, so a
+//  scrape never blocks or slows a planning thread.
+//
+
+#ifndef metrics_exporter_hpp
+#define metrics_exporter_hpp
+
+#include <string>
+#include <vector>
+#include "planner_session.hpp"
+
+using namespace std;
+
+class MetricsExporter {
+public:
+
+    /**
+     * Exports stats, labelled with its name. Call before any thread renders;
+     * stats must outlive the exporter.
+     */
+    void add(const PipelineStats &stats);
+
+    // Prometheus text exposition format, version 0.0.4
+    string render() const;
+
+private:
+
+    vector<const PipelineStats *> listeners;
+};
+
+#endif /* metrics_exporter_hpp */
@@ -0,0 +1,211 @@
+//
+//  object_tracker.cpp
+//  path_planning
+//
+//  Keeps every sensed car across frames, keyed by its sensor fusion id: a
+//  ring buffer of its recent Frenet states, from which its acceleration and
+//  lateral speed are estimated, and a Kalman filter smoothing its state.
+//  Slots come from a fixed pool and are reused once a car has been gone for a
+//  while, so tracking never allocates after construction.
+//
+
+#include "object_tracker.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+
+// Least-squares slope of y over t for the n states of a ring
+static double slope(const double *t, const double *y, int n) {
+    if (n < 2) {
+        return 0;
+    }
+    double t_mean = 0;
+    double y_mean = 0;
+    for (int k = 0; k < n; k++) {
+        t_mean += t[k];
+        y_mean += y[k];
+    }
+    t_mean /= n;
+    y_mean /= n;
+    double cov = 0;
+    double var = 0;
+    for (int k = 0; k < n; k++) {
+        cov += (t[k] - t_mean) * (y[k] - y_mean);
+        var += (t[k] - t_mean) * (t[k] - t_mean);
+    }
+    // states at one instant carry no slope
+    return var > 1e-12 ? cov / var : 0;
+}
+
+ObjectTracker::ObjectTracker(int capacity) : filters(capacity), capacity(capacity) {
+    slot_id.assign(capacity, 0);
+    last_seen.assign(capacity, 0);
+    count.assign(capacity, 0);
+    head.assign(capacity, 0);
+    hist_t.assign(capacity * HISTORY, 0);
+    hist_d.assign(capacity * HISTORY, 0);
+    hist_s_dot.assign(capacity * HISTORY, 0);
+    active.reserve(capacity);
+    free_slots.reserve(capacity);
+    frame_slots.reserve(max(capacity, TELEMETRY_MAX_CARS));
+    released_ids.reserve(capacity);
+
+    // at most half full, so probes stay short
+    uint32_t size = 1;
+    while (size < 2 * (uint32_t)capacity) {
+        size <<= 1;
+    }
+    table.assign(size, -1);
+    mask = size - 1;
+    reset();
+}
+
+void ObjectTracker::reset() {
+    active.clear();
+    free_slots.clear();
+    for (int slot = capacity - 1; slot >= 0; slot--) {
+        free_slots.push_back(slot);
+    }
+    fill(table.begin(), table.end(), -1);
+    frame_slots.clear();
+    released_ids.clear();
+}
+
+int ObjectTracker::bucket(int id) const {
+    return ((uint32_t)id * 2654435761u) & mask;
+}
+
+int ObjectTracker::find(int id) const {
+    for (uint32_t b = bucket(id);; b = (b + 1) & mask) {
+        int slot = table[b];
+        if (slot < 0 || slot_id[slot] == id) {
+            return slot;
+        }
+    }
+}
+
+int ObjectTracker::acquire(int id) {
+    if (free_slots.empty()) {
+        return -1;
+    }
+    int slot = free_slots.back();
+    free_slots.pop_back();
+    active.push_back(slot);
+    slot_id[slot] = id;
+    count[slot] = 0;
+    head[slot] = 0;
+
+    uint32_t b = bucket(id);
+    while (table[b] >= 0) {
+        b = (b + 1) & mask;
+    }
+    table[b] = slot;
+    return slot;
+}
+
+void ObjectTracker::release(int slot) {
+    released_ids.push_back(slot_id[slot]);
+    free_slots.push_back(slot);
+
+    uint32_t hole = bucket(slot_id[slot]);
+    while (table[hole] != slot) {
+        hole = (hole + 1) & mask;
+    }
+    /* Backward shift: entries after the hole whose home bucket is not
+       between the hole and them move into it, so lookups never stop early. */
+    table[hole] = -1;
+    for (uint32_t b = (hole + 1) & mask; table[b] >= 0; b = (b + 1) & mask) {
+        uint32_t home = bucket(slot_id[table[b]]);
+        if (((b - home) & mask) >= ((b - hole) & mask)) {
+            table[hole] = table[b];
+            table[b] = -1;
+            hole = b;
+        }
+    }
+}
+
+void ObjectTracker::update(double t, const int *ids, const double *s, const double *d, const double *s_dot,
+                           const double *d_dot, int n) {
+    frame++;
+    released_ids.clear();
+    frame_slots.resize(n);
+
+    for (int i = 0; i < n; i++) {
+        int slot = find(ids[i]);
+        if (slot < 0) {
+            slot = acquire(ids[i]);
+        }
+        frame_slots[i] = slot;
+        if (slot < 0) {
+            continue;
+        }
+        last_seen[slot] = frame;
+        if (count[slot] == 0) {
+            filters.init(slot, s[i], s_dot[i], d[i], d_dot[i]);
+        } else {
+            double last_t = hist_t[slot * HISTORY + (head[slot] + HISTORY - 1) % HISTORY];
+            filters.measure(slot, t - last_t, s[i], s_dot[i], d[i], d_dot[i]);
+        }
+        int k = slot * HISTORY + head[slot];
+        hist_t[k] = t;
+        hist_d[k] = d[i];
+        hist_s_dot[k] = s_dot[i];
+        head[slot] = (head[slot] + 1) % HISTORY;
+        count[slot] = min(count[slot] + 1, HISTORY);
+    }
+    filters.step(max_s);
+
+    for (size_t a = 0; a < active.size();) {
+        int slot = active[a];
+        if (frame - last_seen[slot] > max_missed) {
+            release(slot);
+            active[a] = active.back();
+            active.pop_back();
+        } else {
+            a++;
+        }
+    }
+}
+
+void ObjectTracker::estimate(int n, double *s_ddot, double *d_dot) const {
+    for (int i = 0; i < n; i++) {
+        int slot = i < (int)frame_slots.size() ? frame_slots[i] : -1;
+        if (slot < 0) {
+            s_ddot[i] = 0;
+            d_dot[i] = 0;
+            continue;
+        }
+        // the ring's order does not matter to a least-squares fit
+        const double *t = hist_t.data() + slot * HISTORY;
+        s_ddot[i] = slope(t, hist_s_dot.data() + slot * HISTORY, count[slot]);
+        d_dot[i] = slope(t, hist_d.data() + slot * HISTORY, count[slot]);
+    }
+}
+
+void ObjectTracker::filtered(int n, double *s, double *s_dot, double *s_ddot, double *d, double *d_dot) const {
+    for (int i = 0; i < n && i < (int)frame_slots.size(); i++) {
+        int slot = frame_slots[i];
+        if (slot < 0) {
+            continue;
+        }
+        s[i] = filters.s[slot];
+        s_dot[i] = filters.s_dot[slot];
+        s_ddot[i] = filters.s_ddot[slot];
+        d[i] = filters.d[slot];
+        d_dot[i] = filters.d_dot[slot];
+    }
+}
+
+int ObjectTracker::tracked() const {
+    return active.size();
+}
+
+int ObjectTracker::history(int id) const {
+    int slot = find(id);
+    return slot < 0 ? 0 : count[slot];
+}
+
+const vector<int> &ObjectTracker::released() const {
+    return released_ids;
+}
@@ -0,0 +1,124 @@
+//
+//  object_tracker.hpp
+//  path_planning
+//
+//  Keeps every sensed car across frames, keyed by its sensor fusion id: a
+//  ring buffer of its recent Frenet states, from which its acceleration and
+//  lateral speed are estimated, and a Kalman filter smoothing its state.
+//  Slots come from a fixed pool and are reused once a car has been gone for a
+//  while, so tracking never allocates after construction.
+//
+
+#ifndef object_tracker_hpp
+#define object_tracker_hpp
+
+#include <stdint.h>
+#include <vector>
+#include "kalman_bank.hpp"
+#include "telemetry.hpp"
+
+using namespace std;
+
+class ObjectTracker {
+public:
+
+    // states kept per car
+    static const int HISTORY = 16;
+
+    // updates a car may miss before its slot is released
+    int max_missed = 25;
+
+    // length of the track; s wraps at it, 0 for no wrap
+    double max_s = 0;
+
+    // one filter per slot, stepped by every update
+    KalmanBank filters;
+
+    /**
+     * Constructor. capacity cars can be tracked at once.
+     */
+    ObjectTracker(int capacity = 2 * TELEMETRY_MAX_CARS);
+
+    ObjectTracker(const ObjectTracker &) = delete;
+    ObjectTracker &operator=(const ObjectTracker &) = delete;
+
+    /**
+     * Adds s, d, s_dot and d_dot of n cars observed at time t [s], steps their
+     * filters, and releases the slots of cars missing for more than
+     * max_missed updates. Cars beyond the capacity are not tracked.
+     */
+    void update(double t, const int *ids, const double *s, const double *d, const double *s_dot, const double *d_dot,
+                int n);
+
+    /**
+     * Least-squares s_ddot and d_dot over the history of the n cars of the
+     * last update, in its order. 0 for cars seen fewer than twice.
+     */
+    void estimate(int n, double *s_ddot, double *d_dot) const;
+
+    /**
+     * Filtered s, s_dot, s_ddot, d and d_dot of the n cars of the last
+     * update, in its order. Cars that are not tracked keep what the arrays
+     * hold.
+     */
+    void filtered(int n, double *s, double *s_dot, double *s_ddot, double *d, double *d_dot) const;
+
+    // cars tracked now
+    int tracked() const;
+
+    // states held for id, 0 if it is not tracked
+    int history(int id) const;
+
+    // ids whose slots the last update released
+    const vector<int> &released() const;
+
+    // all slots and their history dropped
+    void reset();
+
+private:
+
+    int capacity;
+
+    long frame = 0;
+
+    // per slot: id, last update it was seen in, states held, next ring index
+    vector<int> slot_id;
+
+    vector<long> last_seen;
+
+    vector<int> count;
+
+    vector<int> head;
+
+    // ring buffers, HISTORY entries per slot
+    vector<double> hist_t;
+
+    vector<double> hist_d;
+
+    vector<double> hist_s_dot;
+
+    // slots in use, and free ones to hand out
+    vector<int> active;
+
+    vector<int> free_slots;
+
+    // open addressing from id to slot, -1 when empty
+    vector<int> table;
+
+    uint32_t mask;
+
+    // slot of every car of the last update, -1 if it was not tracked
+    vector<int> frame_slots;
+
+    vector<int> released_ids;
+
+    int bucket(int id) const;
+
+    int find(int id) const;
+
+    int acquire(int id);
+
+    void release(int slot);
+};
+
+#endif /* object_tracker_hpp */
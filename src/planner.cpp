@@ -0,0 +1,376 @@
+//
+//  planner.cpp
+//  path_planning
+//
+//  Planning core: turns one telemetry frame into the next path to drive,
+//  whatever protocol the frame arrived in. One planner per simulator.
+//
+
+#include "planner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include "frenet.hpp"
+#include "spline.h"
+
+
+static long elapsed_ns(chrono::steady_clock::time_point since) {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - since).count();
+}
+
+Planner::Planner(const RoadMap &road, float max_acc)
+    : road(road),
+      road_view(road),
+      ego(lane, 0, 0, 0, 0) {
+    ego.configure(road.max_s, max_acc, 0);
+    object_tracker.max_s = road.max_s;
+}
+
+bool Planner::sync_path(const TelemetryFrame &frame) {
+    // the simulator drives one point per dt, so what it consumed is the time
+    // since the last frame
+    int driven = emitted_path.consume(frame.path_size, frame.end_path_s, frame.end_path_d, road.max_s);
+    if (driven >= 0) {
+        track_time += driven*dt;
+        return true;
+    }
+    track_time += dt;
+    return false;
+}
+
+void Planner::rebuild_path(const TelemetryFrame &frame)
+{
+    emitted_path.clear();
+    double v = frame.speed/2.24;
+    for (int i = 0; i < frame.path_size; i++) {
+        PathPoint point;
+        point.x = frame.previous_path_x[i];
+        point.y = frame.previous_path_y[i];
+        if (i == 0) {
+            road_view.getFrenet(point.x, point.y, point.s, point.d);
+        } else {
+            road_view.getFrenet(point.x, point.y, emitted_path.back().s, 4, point.s, point.d);
+        }
+        point.v = i == 0 ? v : distance(emitted_path.back().x, emitted_path.back().y, point.x, point.y)/dt;
+        point.a = i == 0 ? 0 : (point.v - emitted_path.back().v)/dt;
+        emitted_path.push(point);
+    }
+}
+
+void Planner::reset() {
+    emitted_path.clear();
+    object_tracker.reset();
+}
+
+void Planner::plan(const TelemetryFrame &frame, vector<double> &next_x_vals, vector<double> &next_y_vals) {
+    
+    auto stage_start = chrono::steady_clock::now();
+    
+    // Main car's localization Data
+    double car_x = frame.x;
+    double car_y = frame.y;
+    double car_s = frame.s;
+    double car_d = frame.d;
+    double car_yaw = frame.yaw;
+    double car_speed = frame.speed;
+    
+    //parameters
+    int horizon = 40;
+    double target_x = 25;
+    float interval = 1.2;
+    
+    // update car parameters with measurement
+    ego.s = car_s;
+    ego.d = car_d;
+    ego.v = car_speed/2.24; // [m/s]
+    
+    
+    
+    // Previous path data given to the Planner: what is left of the points
+    // we emitted, lined up by sync_path()
+    int prev_size = emitted_path.size();
+    // Previous path's end s and d values
+    double end_path_s = prev_size > 0 ? emitted_path.back().s : frame.end_path_s;
+    double end_path_d = prev_size > 0 ? emitted_path.back().d : frame.end_path_d;
+    
+    // Sensor Fusion Data, a list of all other cars on the same side of the road.
+    // project all sensed cars onto the map in one batch
+    int n_cars = frame.n_cars;
+    const int *fusion_id = frame.car_id;
+    double fusion_s[TELEMETRY_MAX_CARS], fusion_d[TELEMETRY_MAX_CARS];
+    double fusion_s_dot[TELEMETRY_MAX_CARS], fusion_d_dot[TELEMETRY_MAX_CARS];
+    road_view.update(car_s);
+    road_view.getFrenet(frame.car_id, frame.car_x, frame.car_y, frame.car_vx, frame.car_vy, n_cars,
+                        fusion_s, fusion_d, fusion_s_dot, fusion_d_dot, newton_iterations);
+    
+    ego.prev_points = prev_size;
+    
+    if (prev_size > 0){
+        car_s = end_path_s;
+    }
+    
+    bool too_close = false;
+    
+    // filtered state of every tracked car; the rest keep the raw projection
+    // and no acceleration
+    object_tracker.update(track_time, fusion_id, fusion_s, fusion_d, fusion_s_dot, fusion_d_dot, n_cars);
+    for (int id : object_tracker.released()) {
+        road_view.forget(id);
+    }
+    double fusion_s_ddot[TELEMETRY_MAX_CARS];
+    fill(fusion_s_ddot, fusion_s_ddot + n_cars, 0.0);
+    object_tracker.filtered(n_cars, fusion_s, fusion_s_dot, fusion_s_ddot, fusion_d, fusion_d_dot);
+    
+    // roll every car forward over the horizon; the behaviour planner works
+    // with s unwrapped, as the ego's, so no wrap at max_s
+    predictor.predict(fusion_s, fusion_d, fusion_s_dot, fusion_d_dot, fusion_s_ddot, n_cars, MOTION_CA, 0, prediction);
+    int interval_row = prediction.row_at(interval);
+    const double *predicted_s = prediction.s_at(interval_row);
+    const double *predicted_v = prediction.v_at(interval_row);
+    intent_predictor.predict(prediction, fusion_d_dot, intents);
+    const double *p_left = intents.p_of(INTENT_LEFT);
+    const double *p_right = intents.p_of(INTENT_RIGHT);
+    // where every mode has taken each car by the decision time
+    const double *d_keep = intents.d_at(INTENT_KEEP, interval_row);
+    const double *d_left = intents.d_at(INTENT_LEFT, interval_row);
+    const double *d_right = intents.d_at(INTENT_RIGHT, interval_row);
+    
+    traffic.clear();
+    
+    for(int i = 0; i < n_cars;i++){
+        float d = fusion_d[i];
+        double check_speed = fusion_s_dot[i];
+        double check_car_s = fusion_s[i];
+        if ( (d < 2+ 4*lane +2) && ( d > 2+ 4*lane-2)){
+            check_car_s += (double)prev_size*dt*check_speed;
+            
+            // check s value greater than mine and s gap
+            if((check_car_s > car_s) && ((check_car_s-car_s) < 30) ){
+                // decrease velocity, maybe change lane
+                //ref_vel = 29.5;
+                too_close = true;
+            }
+        }
+        int id = fusion_id[i];
+        // a car straddling the edge of the road counts in the outer lane
+        int check_lane = intent_predictor.road_lane(d);
+        //cout <<" d is "<< d;
+        //cout <<" lane is "<< check_lane<<endl;
+        //if( (0 <= check_lane) && (check_lane<=2)){
+            //cout<<"car id "<<id<<" lane "<<check_lane<<" speed "<<check_speed<<endl;
+            // the car one interval ahead, kept in its lane, no faster than the limit
+            double pred_v = min(predicted_v[i], ego.target_speed);
+        //cout<<"prediction id"<< id <<" lane "<<check_lane<<" speed "<<pred_v<<endl;
+        
+        traffic.add(id, check_lane, predicted_s[i], d, pred_v, fusion_s_ddot[i]);
+        traffic.set_intent(p_left[i], p_right[i], d_keep[i], d_left[i], d_right[i]);
+        //}
+    }
+    traffic.finish();
+    stage_times.predict_ns = elapsed_ns(stage_start);
+    stage_start = chrono::steady_clock::now();
+    
+    // ego predictions
+    //predictions[-1] = ego.generate_predictions();
+    ego.dt = interval;
+    vector<Vehicle> trajectory =  ego.choose_next_state(traffic);
+    ego.realize_next_state(trajectory);
+    if (Vehicle::verbose) {
+        cout<<"-----------------"<<endl;
+        cout<<"next state "<<ego.state<<endl;
+        cout<<"next lane "<<ego.lane<<endl;
+    }
+    // set the predicted lane as from fsm
+    bool adapt_speed = false;
+    if(abs(lane-ego.lane)>0 && (ego.v < ref_vel)){
+        adapt_speed = true;
+    }
+
+    //keep lane if no improvement in velocity
+    if (abs(ego.v*2.4 - car_speed) > 0.3){
+        lane = ego.lane;
+    }else if (Vehicle::verbose){
+        cout<<"keeping lane"<<endl;
+    }
+    stage_times.decide_ns = elapsed_ns(stage_start);
+    stage_start = chrono::steady_clock::now();
+    
+
+    next_x_vals.clear();
+    next_y_vals.clear();
+    
+    
+    // waypoints that serve as reference points to the trajectory
+    vector<double> ptsx;
+    vector<double> ptsy;
+    
+    double ref_x = car_x;
+    double ref_y = car_y;
+    double ref_yaw = deg2rad(car_yaw);
+    
+    if (prev_size < 2)
+    {
+        //Use two points that make the path tangent to the car
+        double prev_car_x = ref_x - cos(car_yaw);
+        double prev_car_y = ref_y - sin(car_yaw);
+        
+        ptsx.push_back(prev_car_x);
+        ptsx.push_back(car_x);
+        
+        ptsy.push_back(prev_car_y);
+        ptsy.push_back(car_y);
+        
+    }
+    // use the prevous path's end point as starting reference
+    else
+    {
+        //Redefine reference state as previous path end point
+        ref_x = emitted_path[prev_size-1].x;
+        ref_y = emitted_path[prev_size-1].y;
+        
+        double ref_x_prev = emitted_path[prev_size-2].x;
+        double ref_y_prev = emitted_path[prev_size-2].y;
+        ref_yaw = atan2(ref_y-ref_y_prev, ref_x-ref_x_prev);
+        
+        ptsx.push_back(ref_x_prev);
+        ptsx.push_back(ref_x);
+        
+        ptsy.push_back(ref_y_prev);
+        ptsy.push_back(ref_y);
+    }
+    
+    int size_pts = ptsx.size();
+    
+    // anchor points in the target lane, converted in one batch
+    double next_wp_sd[] = {car_s+45, 2.0+(4*lane), car_s+50, 2.0+(4*lane), car_s+55, 2.0+(4*lane)};
+    double next_wp_x[3];
+    double next_wp_y[3];
+    road_view.getXY(next_wp_sd, 3, next_wp_x, next_wp_y);
+    
+    
+    ptsx.push_back(next_wp_x[0]);
+    ptsx.push_back(next_wp_x[1]);
+    ptsx.push_back(next_wp_x[2]);
+    
+    
+    ptsy.push_back(next_wp_y[0]);
+    ptsy.push_back(next_wp_y[1]);
+    ptsy.push_back(next_wp_y[2]);
+    
+    
+    // change into car coordinate system
+    for(int i = 0; i < ptsx.size();i++)
+    {
+        double shift_x = ptsx[i] - ref_x;
+        double shift_y = ptsy[i] - ref_y;
+        
+        ptsx[i] = shift_x * cos(0-ref_yaw) - shift_y * sin(0-ref_yaw);
+        ptsy[i] = shift_x * sin(0-ref_yaw) + shift_y * cos(0-ref_yaw);
+        //cout<<"ptsx "<< ptsx[i] <<endl;
+    }
+    
+    // create a spline
+    tk::spline s;
+    
+    // set points to spline
+    s.set_points(ptsx,ptsy);
+    
+    
+    
+    int no_points = prev_size;
+    
+    //no_points = min(no_points,3);
+    
+
+    //calculate how to break up target speed
+    
+    double target_y = s(target_x);
+    double target_dist = sqrt((target_x*target_x)+(target_y*target_y));
+    
+    // Fill up the rest of the path planner
+    double x_add_on = 0;
+    
+   
+    
+    double ego_v = ego.v*2.24;
+    if (Vehicle::verbose) {
+        cout<<"ego speed "<<ego_v<<endl;
+    }
+    /*if ( ego_v < 49.5 && (abs(car_speed-ego_v)/dt<.224)){
+        
+         cout<<"keeping veloicty"<<endl;
+        ref_vel = ego_v;
+        too_close = true;
+        
+    }*/
+    
+    // Start with all the previuos path points
+    for(int i = 0; i< no_points; i++)
+    {
+        next_x_vals.push_back(emitted_path[i].x);
+        next_y_vals.push_back(emitted_path[i].y);
+    }
+    
+
+   
+
+    /*if (( ego.state.compare("PLCR") == 0 || ego.state.compare("PLCL") == 0) && ref_vel <ego_v)
+        adapt_speed = true;
+
+    double needed_acc = (ref_vel-car_speed)/dt;
+    
+    if (needed_acc > 0.224 && car_speed > 49 && car_speed < 49.5){
+        cout<<"exceeding acceleration!!!"<<endl;
+        //adapt_speed = true;
+        ref_vel = car_speed;
+    }*/
+
+    
+    for( int i = 0; i< horizon  - no_points;i++){
+        
+        if (too_close || adapt_speed){
+            ref_vel -= .224/2;
+        }else if(ref_vel < 49.5  && (ref_vel < ego_v)){
+            ref_vel += .224;
+
+        }
+
+        // d = v*dt*N
+        double N = (target_dist/(0.02 * ref_vel/2.24));
+        
+
+        double x_point = x_add_on + (target_x/N);
+        double y_point = s(x_point);
+        
+        x_add_on = x_point;
+        
+        //cout <<"i "<< i <<" val "<< x_point <<endl;
+        
+        double x_ref = x_point;
+        double y_ref = y_point;
+        
+        //rotate from car cs into global cs
+        x_point = x_ref*cos(ref_yaw)-y_ref*sin(ref_yaw);
+        y_point = x_ref*sin(ref_yaw)+y_ref*cos(ref_yaw);
+        
+        //shift
+        x_point += ref_x;
+        y_point += ref_y;
+        
+        next_x_vals.push_back(x_point);
+        next_y_vals.push_back(y_point);
+        
+        // remember the point with the state it was generated with
+        PathPoint point;
+        point.x = x_point;
+        point.y = y_point;
+        road_view.getFrenet(x_point, y_point, emitted_path.size() > 0 ? emitted_path.back().s : car_s, newton_iterations,
+                            point.s, point.d);
+        point.v = ref_vel/2.24;
+        point.a = emitted_path.size() > 0 ? (point.v - emitted_path.back().v)/dt : 0;
+        emitted_path.push(point);
+    }
+    stage_times.generate_ns = elapsed_ns(stage_start);
+}
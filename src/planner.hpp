@@ -0,0 +1,118 @@
+//
+//  planner.hpp
+//  path_planning
+//
+//  Planning core: turns one telemetry frame into the next path to drive,
+//  whatever protocol the frame arrived in. One planner per simulator.
+//
+
+#ifndef planner_hpp
+#define planner_hpp
+
+#include <vector>
+#include "emitted_path.hpp"
+#include "intent_predictor.hpp"
+#include "object_tracker.hpp"
+#include "road_map.hpp"
+#include "road_view.hpp"
+#include "telemetry.hpp"
+#include "traffic_predictor.hpp"
+#include "traffic_snapshot.hpp"
+#include "vehicle.hpp"
+
+using namespace std;
+
+// Time plan() spent in each stage of one frame [ns]
+struct PlanStageTimes {
+
+    // sensed cars to Frenet, and their predicted trajectories
+    long predict_ns = 0;
+
+    // the behaviour state machine choosing state and lane
+    long decide_ns = 0;
+
+    // the spline path through the anchors
+    long generate_ns = 0;
+};
+
+class Planner {
+public:
+
+    // Newton iterations allowed when projecting cars onto the reference line
+    int newton_iterations = 4;
+
+    // stage times of the last plan()
+    PlanStageTimes stage_times;
+
+    /**
+     * Constructor. road is shared and must outlive the planner.
+     */
+    Planner(const RoadMap &road, float max_acc = 10);
+
+    Planner(const Planner &) = delete;
+    Planner &operator=(const Planner &) = delete;
+
+    /**
+     * Lines the emitted path up with the path_size points the simulator has
+     * left, ending at end_path_s/d. Returns false when it cannot (first frame,
+     * reconnect); the caller then passes the echoed points, or none, to
+     * rebuild_path().
+     */
+    bool sync_path(const TelemetryFrame &frame);
+
+    /**
+     * Refills the emitted path from frame.previous_path_x/y. Speeds come from
+     * the point spacing.
+     */
+    void rebuild_path(const TelemetryFrame &frame);
+
+    /**
+     * Plans the next path from frame, after sync_path() or rebuild_path(), into
+     * next_x_vals/next_y_vals: the points kept from the previous path followed
+     * by the new ones.
+     */
+    void plan(const TelemetryFrame &frame, vector<double> &next_x_vals, vector<double> &next_y_vals);
+
+    /**
+     * Forgets the emitted path, e.g. when the simulator disconnects.
+     */
+    void reset();
+
+private:
+
+    const RoadMap &road;
+
+    // every conversion between Frenet and Cartesian coordinates
+    RoadView road_view;
+
+    // ring of recent states and Kalman filtered state of every sensed car,
+    // and the simulator time they are kept in [s]
+    ObjectTracker object_tracker;
+
+    double track_time = 0;
+
+    // the points sent to the simulator, so previous_path need not be parsed
+    EmittedPath emitted_path;
+
+    Vehicle ego;
+
+    // the sensed cars over the horizon, their lane-change intent, and the
+    // cars one interval ahead by lane; all reused across frames
+    TrafficPredictor predictor;
+
+    PredictionTensor prediction;
+
+    IntentPredictor intent_predictor;
+
+    IntentPrediction intents;
+
+    TrafficSnapshot traffic;
+
+    double dt = .02; //s
+
+    double ref_vel = 0.0; //mph
+
+    int lane = 1;
+};
+
+#endif /* planner_hpp */
@@ -0,0 +1,347 @@
+//
+//  planner_client.cpp
+//  path_planning
+//
+//  Reference client for the binary protocol: stands in for the simulator,
+//  driving along the paths the planner returns, and reports the round-trip
+//  latency of every frame. Speaks the shared memory channel, or a websocket
+//  over TCP or a unix socket, so the transports can be compared on one host.
+//  Positions are projected on the map, as the simulator reports them.
+//
+//  Usage: planner_client shm [name] [frames] [map]
+//         planner_client ws [port] [frames] [map]
+//         planner_client unix [path] [frames] [map]
+//
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#include "binary_protocol.hpp"
+#include "road_map.hpp"
+#include "shm_channel.hpp"
+
+using namespace std;
+
+// path points the simulator drives between two telemetry frames
+static const int POINTS_PER_FRAME = 3;
+
+// A car that follows the returned path exactly, as the simulator does
+struct SimulatedCar {
+
+    const RoadMap &road;
+
+    TelemetryFrame frame;
+
+    // the planner's last path, minus the points driven
+    vector<double> path_x;
+
+    vector<double> path_y;
+
+    SimulatedCar(const RoadMap &road) : road(road) {
+        memset(&frame, 0, sizeof(frame));
+        // the simulator's start position
+        frame.x = 909.48;
+        frame.y = 1128.67;
+        frame.s = 124.8336;
+        frame.d = 6.164833;
+        // a few cars ahead in the other lanes
+        frame.n_cars = 6;
+        for (int i = 0; i < frame.n_cars; i++) {
+            frame.car_id[i] = i;
+            frame.car_x[i] = frame.x + 40 + i * 25;
+            frame.car_y[i] = frame.y + (i % 2 ? -4 : 4) * 0.001;
+            frame.car_vx[i] = 18 + i;
+            frame.car_s[i] = frame.s + 40 + i * 25;
+            frame.car_d[i] = 2 + (i % 2) * 8;
+        }
+    }
+
+    // Drives the first points of the new path, then moves the other cars
+    void step(const double *next_x, const double *next_y, int n) {
+        int driven = min(n, POINTS_PER_FRAME);
+        double travelled = 0;
+        double last_x = frame.x;
+        double last_y = frame.y;
+        for (int i = 0; i < driven; i++) {
+            travelled += hypot(next_x[i] - last_x, next_y[i] - last_y);
+            last_x = next_x[i];
+            last_y = next_y[i];
+        }
+        if (driven > 0) {
+            frame.yaw = atan2(last_y - frame.y, last_x - frame.x) * 180 / M_PI;
+            frame.speed = travelled / (driven * 0.02) * 2.24;
+            frame.x = last_x;
+            frame.y = last_y;
+            vector<double> sd = road.line.getFrenet(frame.x, frame.y, frame.s + travelled);
+            frame.s = sd[0];
+            frame.d = sd[1];
+        }
+        path_x.assign(next_x + driven, next_x + n);
+        path_y.assign(next_y + driven, next_y + n);
+        frame.path_size = path_x.size();
+        frame.end_path_s = 0;
+        frame.end_path_d = 0;
+        if (!path_x.empty()) {
+            // the simulator's end_path_s/d: where the points left end
+            double ahead = 0;
+            for (size_t i = 1; i < path_x.size(); i++) {
+                ahead += hypot(path_x[i] - path_x[i - 1], path_y[i] - path_y[i - 1]);
+            }
+            vector<double> sd = road.line.getFrenet(path_x.back(), path_y.back(), frame.s + ahead);
+            frame.end_path_s = sd[0];
+            frame.end_path_d = sd[1];
+        }
+        for (int i = 0; i < frame.n_cars; i++) {
+            frame.car_x[i] += frame.car_vx[i] * driven * 0.02;
+            frame.car_s[i] += frame.car_vx[i] * driven * 0.02;
+        }
+    }
+};
+
+// Blocking websocket client, just enough for binary frames on localhost
+class WebSocketClient {
+public:
+
+    ~WebSocketClient() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool connect(int port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || ::connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return handshake("localhost:" + to_string(port));
+    }
+
+    bool connect(const string &path) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (fd < 0 || path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        strcpy(address.sun_path, path.c_str());
+        if (::connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+            return false;
+        }
+        return handshake("localhost");
+    }
+
+    bool handshake(const string &host) {
+        string request = "GET / HTTP/1.1\r\nHost: " + host + "\r\n"
+                         "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n"
+                         "Sec-WebSocket-Protocol: " + string(BINARY_PROTOCOL) + "\r\n\r\n";
+        if (!write_all(request.data(), request.size())) {
+            return false;
+        }
+        string response;
+        char c;
+        while (response.size() < 4096 && response.find("\r\n\r\n") == string::npos) {
+            if (recv(fd, &c, 1, 0) != 1) {
+                return false;
+            }
+            response += c;
+        }
+        return response.compare(0, 12, "HTTP/1.1 101") == 0;
+    }
+
+    // Sends one masked binary frame
+    bool send(const char *data, size_t length) {
+        out.clear();
+        out.push_back((char)0x82);
+        if (length < 126) {
+            out.push_back((char)(0x80 | length));
+        } else {
+            out.push_back((char)(0x80 | 126));
+            out.push_back((char)(length >> 8));
+            out.push_back((char)length);
+        }
+        const unsigned char mask[4] = {0x12, 0x34, 0x56, 0x78};
+        out.insert(out.end(), mask, mask + 4);
+        for (size_t i = 0; i < length; i++) {
+            out.push_back(data[i] ^ mask[i & 3]);
+        }
+        return write_all(out.data(), out.size());
+    }
+
+    // Next binary message from the server, skipping any other frames
+    bool receive(vector<char> &message) {
+        while (true) {
+            unsigned char head[2];
+            if (!read_all((char *)head, 2)) {
+                return false;
+            }
+            uint64_t length = head[1] & 0x7f;
+            if (length >= 126) {
+                unsigned char extended[8];
+                int n = length == 126 ? 2 : 8;
+                if (!read_all((char *)extended, n)) {
+                    return false;
+                }
+                length = 0;
+                for (int i = 0; i < n; i++) {
+                    length = length << 8 | extended[i];
+                }
+            }
+            message.resize(length);
+            if (!read_all(message.data(), length)) {
+                return false;
+            }
+            if ((head[0] & 0x0f) == 0x2) {
+                return true;
+            }
+        }
+    }
+
+private:
+
+    int fd = -1;
+
+    vector<char> out;
+
+    bool write_all(const char *data, size_t length) {
+        while (length > 0) {
+            ssize_t n = ::send(fd, data, length, 0);
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    bool read_all(char *data, size_t length) {
+        while (length > 0) {
+            ssize_t n = recv(fd, data, length, 0);
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            length -= n;
+        }
+        return true;
+    }
+};
+
+static void report(const char *transport, vector<double> &latencies) {
+    if (latencies.empty()) {
+        printf("%s: no frames answered\n", transport);
+        return;
+    }
+    sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double l : latencies) {
+        sum += l;
+    }
+    size_t n = latencies.size();
+    printf("%s: %zu frames, round trip mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n", transport, n,
+           sum / n, latencies[n / 2], latencies[min(n - 1, n * 99 / 100)], latencies[n - 1]);
+}
+
+int main(int argc, char **argv) {
+
+    string transport = argc > 1 ? argv[1] : "shm";
+    int frames = argc > 3 ? atoi(argv[3]) : 1000;
+    string map_file = argc > 4 ? argv[4] : "../data/highway_map.csv";
+
+    // the compiled map next to the csv when there is one, as path_planning reads it
+    RoadMap road;
+    string map_bin = map_file.substr(0, map_file.rfind('.')) + ".bin";
+    if (!road.load(map_bin, map_file)) {
+        fprintf(stderr, "Failed to read %s\n", map_file.c_str());
+        return -1;
+    }
+    SimulatedCar car(road);
+    vector<char> telemetry;
+    vector<double> next_x(TELEMETRY_MAX_PATH), next_y(TELEMETRY_MAX_PATH);
+    vector<double> latencies;
+
+    if (transport == "shm") {
+        string name = argc > 2 ? argv[2] : "/path_planning";
+        ShmChannel channel;
+        if (!channel.open(name)) {
+            fprintf(stderr, "Failed to open shared memory channel %s; is path_planning --shm running?\n", name.c_str());
+            return -1;
+        }
+        for (int m = 0; m < frames; m++) {
+            encode_binary_telemetry(car.frame, m, telemetry);
+            auto start = chrono::steady_clock::now();
+            if (!channel.telemetry.write(telemetry.data(), telemetry.size())) {
+                fprintf(stderr, "Telemetry ring full\n");
+                return -1;
+            }
+            size_t length;
+            const char *data = channel.control.read(length, 1000);
+            if (data == nullptr) {
+                fprintf(stderr, "No control frame within 1 s\n");
+                return -1;
+            }
+            uint32_t sequence;
+            int n = decode_binary_control(data, length, next_x.data(), next_y.data(), TELEMETRY_MAX_PATH, sequence);
+            channel.control.release();
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            if (n < 0 || sequence != (uint32_t)m) {
+                fprintf(stderr, "Unexpected control frame\n");
+                return -1;
+            }
+            car.step(next_x.data(), next_y.data(), n);
+        }
+    } else if (transport == "ws" || transport == "unix") {
+        WebSocketClient ws;
+        string where = argc > 2 ? argv[2] : transport == "ws" ? "4567" : "/tmp/path_planning.sock";
+        if (!(transport == "ws" ? ws.connect(atoi(where.c_str())) : ws.connect(where))) {
+            fprintf(stderr, "Failed to connect to %s with %s\n", where.c_str(), BINARY_PROTOCOL);
+            return -1;
+        }
+        vector<char> message;
+        for (int m = 0; m < frames; m++) {
+            encode_binary_telemetry(car.frame, m, telemetry);
+            auto start = chrono::steady_clock::now();
+            if (!ws.send(telemetry.data(), telemetry.size()) || !ws.receive(message)) {
+                fprintf(stderr, "Connection lost\n");
+                return -1;
+            }
+            uint32_t sequence;
+            int n = decode_binary_control(message.data(), message.size(), next_x.data(), next_y.data(),
+                                          TELEMETRY_MAX_PATH, sequence);
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            if (n < 0 || sequence != (uint32_t)m) {
+                fprintf(stderr, "Unexpected control frame\n");
+                return -1;
+            }
+            car.step(next_x.data(), next_y.data(), n);
+        }
+    } else {
+        fprintf(stderr, "Usage: planner_client shm [name] [frames] [map]\n"
+                        "       planner_client ws [port] [frames] [map]\n"
+                        "       planner_client unix [path] [frames] [map]\n");
+        return -1;
+    }
+
+    report(transport.c_str(), latencies);
+    return 0;
+}
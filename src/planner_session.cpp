@@ -0,0 +1,134 @@
+//
+//  planner_session.cpp
+//  path_planning
+//
+//  Everything one simulator connection owns: what it speaks, picked from its
+//  handshake, its buffers and its planner, so simulators served side by side
+//  never share ego, lane or speed. Messages are decoded on the listener thread
+//  and planned on a worker, see PlanningWorker.
+//
+
+#include "planner_session.hpp"
+
+#include <iostream>
+#include <stdio.h>
+#include "allocation_counter.hpp"
+
+
+static long elapsed_ns(chrono::steady_clock::time_point since) {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - since).count();
+}
+
+PipelineStats::PipelineStats(const string &name)
+    : decode(name + " decode"), ingest(name), plan(name + " plan"), predict(name + " predict"),
+      decide(name + " decide"), generate(name + " generate"), serialize(name + " serialize"), allocations(0),
+      handback(name + " handback"), send(name + " send"), total(name), sessions(0) {}
+
+string PipelineStats::report() const {
+    long planned = plan.frames.load();
+    char line[96];
+    snprintf(line, sizeof(line), "%s: %ld allocations, %.1f per frame", plan.name.c_str(), allocations.load(),
+             planned ? (double)allocations.load() / planned : 0.0);
+    return total.report() + "\n" + decode.report() + "\n" + ingest.report() + "\n" + plan.report() + "\n"
+         + predict.report() + "\n" + decide.report() + "\n" + generate.report() + "\n" + serialize.report()
+         + "\n" + line + "\n" + handback.report() + "\n" + send.report();
+}
+
+PlannerSession::PlannerSession(const RoadMap &road, int precision, const string &protocol)
+    : text_writer(precision), planner(road) {
+    // The binary protocol is opt-in: the simulator offers no subprotocol
+    // and keeps the socket.io text messages.
+    binary = offers_protocol(protocol, BINARY_PROTOCOL);
+    reply = {nullptr, 0, false};
+}
+
+bool PlannerSession::ingest(const char *data, size_t length, bool binary_message, PipelineStats &stats) {
+
+    auto start = chrono::steady_clock::now();
+    IngestFrame &in = slot.back();
+    in.binary = binary_message;
+    in.arrival = start;
+
+    if (binary_message) {
+        // binary frames only count on connections that negotiated them
+        if (!binary) {
+            return false;
+        }
+        in.status = decode_binary_telemetry(data, length, in.frame, in.sequence);
+        in.message.clear();
+    } else {
+        // only the path size now: the planner keeps the points it sent, and
+        // goes back to the message in the rare case it cannot line them up
+        in.status = decode_telemetry(data, length, in.frame, TELEMETRY_PATH_SIZE);
+        if (in.status == TELEMETRY_OK) {
+            in.message.assign(data, data + length);
+        }
+    }
+    stats.decode.record(elapsed_ns(start));
+
+    if (in.status == TELEMETRY_MALFORMED) {
+        std::cerr << "Dropped malformed " << (binary_message ? "binary " : "") << "telemetry" << std::endl;
+    }
+    if (in.status != TELEMETRY_OK && in.status != TELEMETRY_MANUAL) {
+        return false;
+    }
+    return slot.publish(stats.ingest) && !in_flight;
+}
+
+bool PlannerSession::plan(PipelineStats &stats) {
+
+    static const char manual[] = "42[\"manual\",{}]";
+    long waited_ns;
+    IngestFrame *in = slot.take(waited_ns, stats.ingest);
+    reply = {nullptr, 0, false};
+    if (in == nullptr) {
+        return false;
+    }
+    arrival = in->arrival;
+    reply.binary = in->binary;
+
+    if (in->status == TELEMETRY_MANUAL) {
+        // Manual driving
+        reply.data = manual;
+        reply.length = sizeof(manual) - 1;
+        planned = chrono::steady_clock::now();
+        return true;
+    }
+
+    auto start = chrono::steady_clock::now();
+    long allocated = thread_allocations();
+    TelemetryFrame &frame = in->frame;
+    if (!planner.sync_path(frame)) {
+        if (in->binary) {
+            // binary clients never echo points back: start over
+            frame.path_size = 0;
+        } else {
+            decode_telemetry(in->message.data(), in->message.size(), frame, TELEMETRY_PATH_VALUES);
+        }
+        planner.rebuild_path(frame);
+    }
+    planner.plan(frame, next_x_vals, next_y_vals);
+    auto planned_path = chrono::steady_clock::now();
+    stats.plan.record(chrono::duration_cast<chrono::nanoseconds>(planned_path - start).count());
+    stats.predict.record(planner.stage_times.predict_ns);
+    stats.decide.record(planner.stage_times.decide_ns);
+    stats.generate.record(planner.stage_times.generate_ns);
+
+    if (in->binary) {
+        binary_writer.write(next_x_vals.data(), next_y_vals.data(), next_x_vals.size(), in->sequence);
+        reply.data = binary_writer.data();
+        reply.length = binary_writer.size();
+    } else {
+        text_writer.write(next_x_vals.data(), next_y_vals.data(), next_x_vals.size());
+        reply.data = text_writer.data();
+        reply.length = text_writer.size();
+    }
+    stats.serialize.record(elapsed_ns(planned_path));
+    stats.allocations.fetch_add(thread_allocations() - allocated, memory_order_relaxed);
+    planned = chrono::steady_clock::now();
+    return true;
+}
+
+bool PlannerSession::waiting() const {
+    return slot.waiting();
+}
@@ -0,0 +1,139 @@
+//
+//  planner_session.hpp
+//  path_planning
+//
+//  Everything one simulator connection owns: what it speaks, picked from its
+//  handshake, its buffers and its planner, so simulators served side by side
+//  never share ego, lane or speed. Messages are decoded on the listener thread
+//  and planned on a worker, see PlanningWorker.
+//
+
+#ifndef planner_session_hpp
+#define planner_session_hpp
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "binary_protocol.hpp"
+#include "control_writer.hpp"
+#include "frame_slot.hpp"
+#include "latency_counters.hpp"
+#include "planner.hpp"
+#include "road_map.hpp"
+
+using namespace std;
+
+// Message to send back; length 0 when there is none
+struct Reply {
+    const char *data;
+    size_t length;
+    bool binary;
+};
+
+// Time spent in every stage and queue of one listener's pipeline
+struct PipelineStats {
+
+    // listener thread: message to decoded frame
+    LatencyCounters decode;
+
+    // frames taken in, dropped as stale, and their wait in the slot
+    IngestCounters ingest;
+
+    // worker thread: path planning, then writing the reply
+    LatencyCounters plan;
+
+    // the stages of plan, see PlanStageTimes
+    LatencyCounters predict;
+
+    LatencyCounters decide;
+
+    LatencyCounters generate;
+
+    LatencyCounters serialize;
+
+    // heap allocations made while planning and serializing
+    atomic<long> allocations;
+
+    // wait between the worker finishing and the listener picking the reply up
+    LatencyCounters handback;
+
+    // listener thread: sending the reply
+    LatencyCounters send;
+
+    // message arrival to reply sent
+    LatencyCounters total;
+
+    // sessions connected
+    atomic<long> sessions;
+
+    PipelineStats(const string &name);
+
+    // one line per stage
+    string report() const;
+};
+
+class PlannerSession {
+public:
+
+    // set when the client offered BINARY_PROTOCOL
+    bool binary = false;
+
+    // sends a reply on the session's socket; set by the listener
+    function<void(const Reply &)> send;
+
+    // listener thread only: handed to the worker and not back yet, and
+    // disconnected meanwhile (deleted once it is back)
+    bool in_flight = false;
+
+    bool closed = false;
+
+    // the last plan's reply, valid once the worker handed the session back
+    Reply reply;
+
+    chrono::steady_clock::time_point arrival;
+
+    chrono::steady_clock::time_point planned;
+
+    /**
+     * Constructor. protocol is the client's Sec-WebSocket-Protocol header.
+     */
+    PlannerSession(const RoadMap &road, int precision, const string &protocol);
+
+    PlannerSession(const PlannerSession &) = delete;
+    PlannerSession &operator=(const PlannerSession &) = delete;
+
+    /**
+     * Listener thread. Decodes a websocket message into the slot. Returns true
+     * when the session has a frame waiting that is not queued for planning.
+     */
+    bool ingest(const char *data, size_t length, bool binary, PipelineStats &stats);
+
+    /**
+     * Worker thread. Plans the newest frame waiting into reply. Returns false
+     * when none is waiting.
+     */
+    bool plan(PipelineStats &stats);
+
+    // true while a frame waits for plan()
+    bool waiting() const;
+
+private:
+
+    ControlWriter text_writer;
+
+    BinaryControlWriter binary_writer;
+
+    FrameSlot slot;
+
+    // the next path, reused across frames
+    vector<double> next_x_vals;
+
+    vector<double> next_y_vals;
+
+    Planner planner;
+};
+
+#endif /* planner_session_hpp */
@@ -0,0 +1,91 @@
+//
+//  planning_worker.cpp
+//  path_planning
+//
+//  Planner thread behind one listener thread. Sessions with a frame waiting
+//  come in through one lock-free queue, are planned, and go back through
+//  another for the listener to send, so a slow plan never stalls the event
+//  loop's other sockets.
+//
+
+#include "planning_worker.hpp"
+
+
+// polls of an empty queue before the worker goes to sleep
+static const int SPIN = 2000;
+
+PlanningWorker::PlanningWorker(PipelineStats &stats, function<void()> wake_listener, size_t capacity)
+    : stats(stats), wake_listener(wake_listener), requests(capacity), results(capacity),
+      stopping(false), sleeping(false) {}
+
+PlanningWorker::~PlanningWorker() {
+    stop();
+}
+
+void PlanningWorker::start() {
+    if (!worker.joinable()) {
+        stopping = false;
+        worker = thread(&PlanningWorker::run, this);
+    }
+}
+
+void PlanningWorker::stop() {
+    if (worker.joinable()) {
+        {
+            lock_guard<mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        sleep_cv.notify_one();
+        worker.join();
+    }
+}
+
+bool PlanningWorker::submit(PlannerSession *session) {
+    if (!requests.push(session)) {
+        return false;
+    }
+    /* seq_cst pairs with the worker's store to sleeping: either it sees the
+       session before sleeping, or this load sees it asleep. */
+    if (sleeping.load(memory_order_seq_cst)) {
+        lock_guard<mutex> lock(sleep_mutex);
+        sleep_cv.notify_one();
+    }
+    return true;
+}
+
+PlannerSession *PlanningWorker::finished() {
+    PlannerSession *session;
+    return results.pop(session) ? session : nullptr;
+}
+
+void PlanningWorker::run() {
+
+    int spins = 0;
+    while (!stopping) {
+        PlannerSession *session;
+        if (requests.pop(session)) {
+            spins = 0;
+            session->plan(stats);
+            /* results holds no more sessions than were submitted, and requests
+               is the same size, so this only spins if the listener submits
+               faster than it collects. */
+            while (!results.push(session)) {
+                this_thread::yield();
+            }
+            wake_listener();
+            continue;
+        }
+
+        if (spins < SPIN) {
+            spins++;
+            continue;
+        }
+        unique_lock<mutex> lock(sleep_mutex);
+        sleeping.store(true, memory_order_seq_cst);
+        if (requests.empty() && !stopping) {
+            sleep_cv.wait(lock);
+        }
+        sleeping.store(false, memory_order_relaxed);
+        spins = 0;
+    }
+}
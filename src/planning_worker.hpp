@@ -0,0 +1,81 @@
+//
+//  planning_worker.hpp
+//  path_planning
+//
+//  Planner thread behind one listener thread. Sessions with a frame waiting
+//  come in through one lock-free queue, are planned, and go back through
+//  another for the listener to send, so a slow plan never stalls the event
+//  loop's other sockets.
+//
+
+#ifndef planning_worker_hpp
+#define planning_worker_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "planner_session.hpp"
+#include "spsc_queue.hpp"
+
+using namespace std;
+
+class PlanningWorker {
+public:
+
+    /**
+     * Constructor. wake_listener is called on the worker thread after every
+     * session handed back, and must make the listener call finished().
+     */
+    PlanningWorker(PipelineStats &stats, function<void()> wake_listener, size_t capacity = 1024);
+
+    /**
+     * Destructor. Stops the thread; sessions still queued stay with their
+     * listener.
+     */
+    ~PlanningWorker();
+
+    PlanningWorker(const PlanningWorker &) = delete;
+    PlanningWorker &operator=(const PlanningWorker &) = delete;
+
+    void start();
+
+    void stop();
+
+    /**
+     * Listener thread. Queues the session for planning. Returns false when the
+     * queue is full.
+     */
+    bool submit(PlannerSession *session);
+
+    /**
+     * Listener thread. The next session planned, or nullptr.
+     */
+    PlannerSession *finished();
+
+private:
+
+    PipelineStats &stats;
+
+    function<void()> wake_listener;
+
+    SpscQueue<PlannerSession *> requests;
+
+    SpscQueue<PlannerSession *> results;
+
+    thread worker;
+
+    atomic<bool> stopping;
+
+    // the worker sleeps here when it has nothing to plan
+    mutex sleep_mutex;
+
+    condition_variable sleep_cv;
+
+    atomic<bool> sleeping;
+
+    void run();
+};
+
+#endif /* planning_worker_hpp */
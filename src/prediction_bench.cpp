@@ -0,0 +1,79 @@
+//
+//  prediction_bench.cpp
+//  path_planning
+//
+//  Time of TrafficPredictor rolling a full sensor fusion list over the
+//  horizon, under both motion models, against a plain car-by-car loop over
+//  the same equations. Checks the two agree.
+//
+//  Usage: prediction_bench [cars] [steps] [runs]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "traffic_predictor.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+
+    int cars = argc > 1 ? atoi(argv[1]) : 64;
+    int steps = argc > 2 ? atoi(argv[2]) : 150;
+    int runs = argc > 3 ? atoi(argv[3]) : 10000;
+    double dt = 0.02;
+
+    vector<double> s(cars), d(cars), s_dot(cars), d_dot(cars), s_ddot(cars);
+    srand(1);
+    for (int i = 0; i < cars; i++) {
+        s[i] = rand() % 6900;
+        d[i] = 2 + 4 * (i % 3) + (rand() % 100 - 50) * 0.01;
+        s_dot[i] = 10 + rand() % 15;
+        d_dot[i] = (rand() % 100 - 50) * 0.01;
+        s_ddot[i] = (rand() % 100 - 60) * 0.1;
+    }
+
+    TrafficPredictor predictor(steps, dt);
+    PredictionTensor tensor;
+    printf("%d cars, %d steps of %.0f ms, kernel %s\n", cars, steps, dt * 1000, TrafficPredictor::kernel());
+
+    for (MotionModel model : {MOTION_CV, MOTION_CA}) {
+        const char *name = model == MOTION_CV ? "constant velocity" : "constant acceleration";
+
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < runs; r++) {
+            predictor.predict(s.data(), d.data(), s_dot.data(), d_dot.data(), s_ddot.data(), cars, model, 6945.554, tensor);
+        }
+        double vector_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / runs;
+
+        // car by car, one car's whole horizon at a time
+        vector<double> ref_s(cars * (steps + 1)), ref_v(cars * (steps + 1));
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < runs; r++) {
+            for (int i = 0; i < cars; i++) {
+                double a = model == MOTION_CA ? s_ddot[i] : 0;
+                double t_stop = a < 0 ? max(0.0, -s_dot[i] / a) : 1e300;
+                for (int k = 0; k <= steps; k++) {
+                    double t = min(k * dt, t_stop);
+                    double next_s = s[i] + t * (s_dot[i] + 0.5 * a * t);
+                    ref_s[i * (steps + 1) + k] = fmod(next_s, 6945.554);
+                    ref_v[i * (steps + 1) + k] = s_dot[i] + a * t;
+                }
+            }
+        }
+        double loop_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / runs;
+
+        double worst = 0;
+        for (int i = 0; i < cars; i++) {
+            for (int k = 0; k <= steps; k++) {
+                worst = max(worst, fabs(tensor.s_at(k)[i] - ref_s[i * (steps + 1) + k]));
+                worst = max(worst, fabs(tensor.v_at(k)[i] - ref_v[i * (steps + 1) + k]));
+            }
+        }
+        printf("%s: predictor %.2f us, car by car %.2f us, max difference %.2g\n", name, vector_us, loop_us, worst);
+    }
+    return 0;
+}
@@ -0,0 +1,425 @@
+//
+//  reference_line.cpp
+//  path_planning
+//
+//  Smooth reference line through the map waypoints, resampled at a fixed s
+//  step so Frenet to Cartesian conversion is an index and a lerp.
+//
+
+#include "reference_line.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include "spline.h"
+#include "simd.hpp"
+
+
+// waypoints repeated on either side of the loop so the splines join smoothly
+static const int WRAP_POINTS = 3;
+
+// samples between the seeds of an unseeded getFrenet, 5 m at the default step
+static const int COARSE_STRIDE = 20;
+
+static const double NEWTON_TOLERANCE = 1e-6;
+
+ReferenceLine::ReferenceLine() {}
+
+ReferenceLine::ReferenceLine(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_s,
+                             const vector<double> &maps_dx, const vector<double> &maps_dy, double max_s, double step) {
+    build(maps_x, maps_y, maps_s, maps_dx, maps_dy, max_s, step);
+}
+
+void ReferenceLine::build(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_s,
+                          const vector<double> &maps_dx, const vector<double> &maps_dy, double max_s, double step) {
+
+    int n = maps_s.size();
+    int wrap = min(WRAP_POINTS, n);
+
+    vector<double> pts_s, pts_x, pts_y, pts_dx, pts_dy;
+    for (int i = n - wrap; i < n; i++) {
+        pts_s.push_back(maps_s[i] - max_s);
+        pts_x.push_back(maps_x[i]);
+        pts_y.push_back(maps_y[i]);
+        pts_dx.push_back(maps_dx[i]);
+        pts_dy.push_back(maps_dy[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        pts_s.push_back(maps_s[i]);
+        pts_x.push_back(maps_x[i]);
+        pts_y.push_back(maps_y[i]);
+        pts_dx.push_back(maps_dx[i]);
+        pts_dy.push_back(maps_dy[i]);
+    }
+    for (int i = 0; i < wrap; i++) {
+        pts_s.push_back(maps_s[i] + max_s);
+        pts_x.push_back(maps_x[i]);
+        pts_y.push_back(maps_y[i]);
+        pts_dx.push_back(maps_dx[i]);
+        pts_dy.push_back(maps_dy[i]);
+    }
+
+    tk::spline spline_x, spline_y, spline_dx, spline_dy;
+    spline_x.set_points(pts_s, pts_x);
+    spline_y.set_points(pts_s, pts_y);
+    spline_dx.set_points(pts_s, pts_dx);
+    spline_dy.set_points(pts_s, pts_dy);
+
+    this->max_s = max_s;
+    inv_max_s = 1.0 / max_s;
+    first_s = 0;
+    wrap_back = 0;
+    samples = max(1, (int)ceil(max_s / step));
+    sample_step = max_s / samples;
+    inv_step = 1.0 / sample_step;
+
+    int stride = samples + 1;
+    storage.assign(6 * stride, 0.0);
+    double *line_x = &storage[0];
+    double *line_y = line_x + stride;
+    double *line_cos = line_y + stride;
+    double *line_sin = line_cos + stride;
+    double *line_nx = line_sin + stride;
+    double *line_ny = line_nx + stride;
+
+    double h = sample_step / 2;
+    for (int i = 0; i < samples; i++) {
+        double s = i * sample_step;
+        line_x[i] = spline_x(s);
+        line_y[i] = spline_y(s);
+
+        double tx = spline_x(s + h) - spline_x(s - h);
+        double ty = spline_y(s + h) - spline_y(s - h);
+        double t_norm = sqrt(tx*tx + ty*ty);
+        line_cos[i] = tx / t_norm;
+        line_sin[i] = ty / t_norm;
+
+        double dx = spline_dx(s);
+        double dy = spline_dy(s);
+        double d_norm = sqrt(dx*dx + dy*dy);
+        line_nx[i] = dx / d_norm;
+        line_ny[i] = dy / d_norm;
+    }
+
+    // close the loop so getXY can always lerp towards sample i+1
+    line_x[samples] = line_x[0];
+    line_y[samples] = line_y[0];
+    line_cos[samples] = line_cos[0];
+    line_sin[samples] = line_sin[0];
+    line_nx[samples] = line_nx[0];
+    line_ny[samples] = line_ny[0];
+
+    x = line_x;
+    y = line_y;
+    cos_heading = line_cos;
+    sin_heading = line_sin;
+    nx = line_nx;
+    ny = line_ny;
+
+    build_coarse_index();
+}
+
+void ReferenceLine::attach(const double *x, const double *y, const double *cos_heading, const double *sin_heading,
+                           const double *nx, const double *ny, int samples, double max_s) {
+    attach_piece(x, y, cos_heading, sin_heading, nx, ny, samples, max_s / samples, 0, max_s);
+    // the whole loop, nothing to wrap back
+    wrap_back = 0;
+}
+
+void ReferenceLine::attach_piece(const double *x, const double *y, const double *cos_heading, const double *sin_heading,
+                                 const double *nx, const double *ny, int samples, double step, double first_s, double max_s) {
+    storage.clear();
+    this->x = x;
+    this->y = y;
+    this->cos_heading = cos_heading;
+    this->sin_heading = sin_heading;
+    this->nx = nx;
+    this->ny = ny;
+    this->samples = samples;
+    this->max_s = max_s;
+    inv_max_s = 1.0 / max_s;
+    sample_step = step;
+    inv_step = 1.0 / sample_step;
+    this->first_s = first_s;
+    wrap_back = max(0.0, (max_s - samples * step) / 2);
+
+    build_coarse_index();
+}
+
+void ReferenceLine::build_coarse_index() {
+
+    coarse_x.clear();
+    coarse_y.clear();
+    for (int i = 0; i < samples; i += COARSE_STRIDE) {
+        coarse_x.push_back(x[i]);
+        coarse_y.push_back(y[i]);
+    }
+    coarse_index.build(coarse_x, coarse_y);
+}
+
+double ReferenceLine::local_s(double s) const {
+    s += wrap_back - first_s;
+    s -= floor(s * inv_max_s) * max_s;
+    return s - wrap_back;
+}
+
+int ReferenceLine::sample_of(double u) const {
+    return min(max((int)u, 0), samples - 1);
+}
+
+vector<double> ReferenceLine::getXY(double s, double d) const {
+
+    double u = local_s(s) * inv_step;
+    int i = sample_of(u);
+    double t = u - i;
+
+    double x_ref = x[i] + t * (x[i+1] - x[i]);
+    double y_ref = y[i] + t * (y[i+1] - y[i]);
+    double n_x = nx[i] + t * (nx[i+1] - nx[i]);
+    double n_y = ny[i] + t * (ny[i+1] - ny[i]);
+
+    return {x_ref + d * n_x, y_ref + d * n_y};
+}
+
+void ReferenceLine::heading(double s, double &cos_h, double &sin_h) const {
+
+    double u = local_s(s) * inv_step;
+    int i = sample_of(u);
+    double t = u - i;
+
+    double c = cos_heading[i] + t * (cos_heading[i+1] - cos_heading[i]);
+    double n = sin_heading[i] + t * (sin_heading[i+1] - sin_heading[i]);
+    double norm = sqrt(c*c + n*n);
+    cos_h = c / norm;
+    sin_h = n / norm;
+}
+
+vector<double> ReferenceLine::getFrenet(double px, double py, double s_seed, int max_iterations, int *iterations) const {
+    double s, d;
+    getFrenet(px, py, s_seed, max_iterations, s, d, iterations);
+    return {s, d};
+}
+
+vector<double> ReferenceLine::getFrenet(double px, double py, int max_iterations, int *iterations) const {
+    double s, d;
+    getFrenet(px, py, max_iterations, s, d, iterations);
+    return {s, d};
+}
+
+void ReferenceLine::getFrenet(double px, double py, double s_seed, int max_iterations, double &s, double &d,
+                              int *iterations) const {
+
+    /* getXY places (s,d) at P(s) + d N(s) with N the map normal, so s is the
+       root of f(s) = N(s) x (p - P(s)). Within a sample P and N are linear,
+       which makes f' exact: N' x r - N x P'. */
+    s = s_seed;
+    int iteration = 0;
+    double rx, ry, n_x, n_y;
+    while (true) {
+        s -= floor(s * inv_max_s) * max_s;
+
+        double u = local_s(s) * inv_step;
+        int i = sample_of(u);
+        double t = u - i;
+
+        double tx = x[i+1] - x[i];
+        double ty = y[i+1] - y[i];
+        double dnx = nx[i+1] - nx[i];
+        double dny = ny[i+1] - ny[i];
+        rx = px - (x[i] + t * tx);
+        ry = py - (y[i] + t * ty);
+        n_x = nx[i] + t * dnx;
+        n_y = ny[i] + t * dny;
+
+        if (iteration == max_iterations) {
+            break;
+        }
+
+        double f = n_x * ry - n_y * rx;
+        double slope = ((dnx * ry - dny * rx) - (n_x * ty - n_y * tx)) * inv_step;
+        // near the centre of curvature the slope vanishes; keep the step bounded
+        if (fabs(slope) < 0.25) {
+            slope = slope < 0 ? -0.25 : 0.25;
+        }
+        double ds = -f / slope;
+
+        s += ds;
+        iteration++;
+        if (fabs(ds) < NEWTON_TOLERANCE) {
+            s -= floor(s * inv_max_s) * max_s;
+            break;
+        }
+    }
+
+    if (iterations) {
+        *iterations = iteration;
+    }
+
+    // offset along the map normal, signed by it
+    d = (rx * n_x + ry * n_y) / (n_x * n_x + n_y * n_y);
+}
+
+void ReferenceLine::getFrenet(double px, double py, int max_iterations, double &s, double &d, int *iterations) const {
+    double s_seed = first_s + coarse_index.closest(px, py) * COARSE_STRIDE * sample_step;
+    getFrenet(px, py, s_seed, max_iterations, s, d, iterations);
+}
+
+// Raw view of the sample arrays handed to the batch kernels
+struct LineSamples {
+    const double *x, *y, *nx, *ny;
+    int last;
+    double inv_step, max_s, inv_max_s;
+    // s + shift wraps into [0, max_s), then back is taken off, see local_s()
+    double shift, back;
+};
+
+typedef void (*BatchKernel)(const LineSamples &line, const double *sd, int begin, int end, double *xs, double *ys);
+
+static inline void xy_scalar(const LineSamples &line, double s, double d, double &x, double &y) {
+    s += line.shift;
+    s -= floor(s * line.inv_max_s) * line.max_s;
+    double u = (s - line.back) * line.inv_step;
+    int i = min(max((int)u, 0), line.last);
+    double t = u - i;
+    double n_x = line.nx[i] + t * (line.nx[i+1] - line.nx[i]);
+    double n_y = line.ny[i] + t * (line.ny[i+1] - line.ny[i]);
+    x = line.x[i] + t * (line.x[i+1] - line.x[i]) + d * n_x;
+    y = line.y[i] + t * (line.y[i+1] - line.y[i]) + d * n_y;
+}
+
+static void batch_scalar(const LineSamples &line, const double *sd, int begin, int end, double *xs, double *ys) {
+    for (int k = begin; k < end; k++) {
+        xy_scalar(line, sd[2*k], sd[2*k+1], xs[k], ys[k]);
+    }
+}
+
+#ifdef PATH_PLANNING_X86
+
+__attribute__((target("avx2")))
+static void batch_avx2(const LineSamples &line, const double *sd, int begin, int end, double *xs, double *ys) {
+    const __m256d inv_max_s = _mm256_set1_pd(line.inv_max_s);
+    const __m256d max_s = _mm256_set1_pd(line.max_s);
+    const __m256d inv_step = _mm256_set1_pd(line.inv_step);
+    const __m256d shift = _mm256_set1_pd(line.shift);
+    const __m256d back = _mm256_set1_pd(line.back);
+    const __m128i last = _mm_set1_epi32(line.last);
+    const __m128i first = _mm_setzero_si128();
+
+    int k = begin;
+    for (; k + 4 <= end; k += 4) {
+        // de-interleave [s0 d0 s1 d1] [s2 d2 s3 d3] into s and d lanes
+        __m256d lo = _mm256_loadu_pd(sd + 2*k);
+        __m256d hi = _mm256_loadu_pd(sd + 2*k + 4);
+        __m256d s = _mm256_permute4x64_pd(_mm256_unpacklo_pd(lo, hi), 0xD8);
+        __m256d d = _mm256_permute4x64_pd(_mm256_unpackhi_pd(lo, hi), 0xD8);
+
+        s = _mm256_add_pd(s, shift);
+        s = _mm256_sub_pd(s, _mm256_mul_pd(_mm256_floor_pd(_mm256_mul_pd(s, inv_max_s)), max_s));
+        __m256d u = _mm256_mul_pd(_mm256_sub_pd(s, back), inv_step);
+        __m128i i = _mm_max_epi32(_mm_min_epi32(_mm256_cvttpd_epi32(u), last), first);
+        __m256d t = _mm256_sub_pd(u, _mm256_cvtepi32_pd(i));
+
+        __m256d x0 = gather_pd(line.x, i);
+        __m256d x1 = gather_pd(line.x + 1, i);
+        __m256d y0 = gather_pd(line.y, i);
+        __m256d y1 = gather_pd(line.y + 1, i);
+        __m256d nx0 = gather_pd(line.nx, i);
+        __m256d nx1 = gather_pd(line.nx + 1, i);
+        __m256d ny0 = gather_pd(line.ny, i);
+        __m256d ny1 = gather_pd(line.ny + 1, i);
+
+        __m256d n_x = _mm256_add_pd(nx0, _mm256_mul_pd(t, _mm256_sub_pd(nx1, nx0)));
+        __m256d n_y = _mm256_add_pd(ny0, _mm256_mul_pd(t, _mm256_sub_pd(ny1, ny0)));
+        __m256d x = _mm256_add_pd(_mm256_add_pd(x0, _mm256_mul_pd(t, _mm256_sub_pd(x1, x0))), _mm256_mul_pd(d, n_x));
+        __m256d y = _mm256_add_pd(_mm256_add_pd(y0, _mm256_mul_pd(t, _mm256_sub_pd(y1, y0))), _mm256_mul_pd(d, n_y));
+
+        _mm256_storeu_pd(xs + k, x);
+        _mm256_storeu_pd(ys + k, y);
+    }
+    batch_scalar(line, sd, k, end, xs, ys);
+}
+
+__attribute__((target("sse4.1")))
+static void batch_sse41(const LineSamples &line, const double *sd, int begin, int end, double *xs, double *ys) {
+    const __m128d inv_max_s = _mm_set1_pd(line.inv_max_s);
+    const __m128d max_s = _mm_set1_pd(line.max_s);
+    const __m128d inv_step = _mm_set1_pd(line.inv_step);
+    const __m128d shift = _mm_set1_pd(line.shift);
+    const __m128d back = _mm_set1_pd(line.back);
+    const __m128i last = _mm_set1_epi32(line.last);
+    const __m128i first = _mm_setzero_si128();
+
+    int k = begin;
+    for (; k + 2 <= end; k += 2) {
+        __m128d p0 = _mm_loadu_pd(sd + 2*k);
+        __m128d p1 = _mm_loadu_pd(sd + 2*k + 2);
+        __m128d s = _mm_unpacklo_pd(p0, p1);
+        __m128d d = _mm_unpackhi_pd(p0, p1);
+
+        s = _mm_add_pd(s, shift);
+        s = _mm_sub_pd(s, _mm_mul_pd(_mm_floor_pd(_mm_mul_pd(s, inv_max_s)), max_s));
+        __m128d u = _mm_mul_pd(_mm_sub_pd(s, back), inv_step);
+        __m128i i = _mm_max_epi32(_mm_min_epi32(_mm_cvttpd_epi32(u), last), first);
+        __m128d t = _mm_sub_pd(u, _mm_cvtepi32_pd(i));
+
+        // no gather before AVX2, load the two samples of each lane by hand
+        int i0 = _mm_cvtsi128_si32(i);
+        int i1 = _mm_extract_epi32(i, 1);
+        __m128d x0 = _mm_set_pd(line.x[i1], line.x[i0]);
+        __m128d x1 = _mm_set_pd(line.x[i1+1], line.x[i0+1]);
+        __m128d y0 = _mm_set_pd(line.y[i1], line.y[i0]);
+        __m128d y1 = _mm_set_pd(line.y[i1+1], line.y[i0+1]);
+        __m128d nx0 = _mm_set_pd(line.nx[i1], line.nx[i0]);
+        __m128d nx1 = _mm_set_pd(line.nx[i1+1], line.nx[i0+1]);
+        __m128d ny0 = _mm_set_pd(line.ny[i1], line.ny[i0]);
+        __m128d ny1 = _mm_set_pd(line.ny[i1+1], line.ny[i0+1]);
+
+        __m128d n_x = _mm_add_pd(nx0, _mm_mul_pd(t, _mm_sub_pd(nx1, nx0)));
+        __m128d n_y = _mm_add_pd(ny0, _mm_mul_pd(t, _mm_sub_pd(ny1, ny0)));
+        __m128d x = _mm_add_pd(_mm_add_pd(x0, _mm_mul_pd(t, _mm_sub_pd(x1, x0))), _mm_mul_pd(d, n_x));
+        __m128d y = _mm_add_pd(_mm_add_pd(y0, _mm_mul_pd(t, _mm_sub_pd(y1, y0))), _mm_mul_pd(d, n_y));
+
+        _mm_storeu_pd(xs + k, x);
+        _mm_storeu_pd(ys + k, y);
+    }
+    batch_scalar(line, sd, k, end, xs, ys);
+}
+
+#endif
+
+static BatchKernel batch_kernel() {
+    switch (simd_level()) {
+#ifdef PATH_PLANNING_X86
+        case SIMD_AVX2:
+            return batch_avx2;
+        case SIMD_SSE41:
+            return batch_sse41;
+#endif
+        default:
+            return batch_scalar;
+    }
+}
+
+void ReferenceLine::getXY(const double *sd, int n, double *xs, double *ys) const {
+    LineSamples line = {x, y, nx, ny, samples - 1, inv_step, max_s, inv_max_s, wrap_back - first_s, wrap_back};
+    batch_kernel()(line, sd, 0, n, xs, ys);
+}
+
+const char *ReferenceLine::kernel() {
+    return simd_level_name(simd_level());
+}
+
+int ReferenceLine::size() const {
+    return samples;
+}
+
+double ReferenceLine::step() const {
+    return sample_step;
+}
+
+double ReferenceLine::length() const {
+    return max_s;
+}
+
+double ReferenceLine::begin() const {
+    return first_s;
+}
@@ -0,0 +1,155 @@
+//
+//  reference_line.hpp
+//  path_planning
+//
+//  Smooth reference line through the map waypoints, resampled at a fixed s
+//  step so Frenet to Cartesian conversion is an index and a lerp.
+//
+
+#ifndef reference_line_hpp
+#define reference_line_hpp
+
+#include <vector>
+#include "waypoint_index.hpp"
+
+using namespace std;
+
+class ReferenceLine {
+public:
+
+    /**
+     * Constructor
+     */
+    ReferenceLine();
+    ReferenceLine(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_s,
+                  const vector<double> &maps_dx, const vector<double> &maps_dy, double max_s, double step = 0.25);
+
+    // the sample pointers may refer to the line's own storage
+    ReferenceLine(const ReferenceLine &) = delete;
+    ReferenceLine &operator=(const ReferenceLine &) = delete;
+
+    /**
+     * Fits splines over s for x, y, dx and dy through the waypoints of the loop
+     * and samples them every step meters. step is rounded so that a whole number
+     * of samples covers [0, max_s).
+     */
+    void build(const vector<double> &maps_x, const vector<double> &maps_y, const vector<double> &maps_s,
+               const vector<double> &maps_dx, const vector<double> &maps_dy, double max_s, double step = 0.25);
+
+    /**
+     * Uses samples + 1 precomputed samples per array, e.g. from a mapped map
+     * file, instead of building them. The arrays are not copied and must
+     * outlive the line.
+     */
+    void attach(const double *x, const double *y, const double *cos_heading, const double *sin_heading,
+                const double *nx, const double *ny, int samples, double max_s);
+
+    /**
+     * Same for a piece of a loop max_s long: samples + 1 samples step meters
+     * apart, the first at first_s. Queries past either end of the piece
+     * extrapolate its end samples, so callers pick the piece holding s.
+     */
+    void attach_piece(const double *x, const double *y, const double *cos_heading, const double *sin_heading,
+                      const double *nx, const double *ny, int samples, double step, double first_s, double max_s);
+
+    // Transform from Frenet s,d coordinates to Cartesian x,y
+    vector<double> getXY(double s, double d) const;
+
+    // Unit tangent of the line at s
+    void heading(double s, double &cos_h, double &sin_h) const;
+
+    /**
+     * Batch transform of n interleaved (s,d) pairs into the caller's x and y
+     * arrays, without allocating. Runs an AVX2 or SSE4.1 kernel when the CPU
+     * has one and a scalar loop otherwise.
+     */
+    void getXY(const double *sd, int n, double *xs, double *ys) const;
+
+    /**
+     * Transform from Cartesian x,y to Frenet s,d on the smooth line, the
+     * inverse of getXY. Newton iterations start from s_seed, usually the car's
+     * previous s or a waypoint projection, and stop after max_iterations or
+     * once the step is below a micrometre. d is measured along, and signed by,
+     * the map normal. The number of iterations run is stored in *iterations.
+     */
+    vector<double> getFrenet(double x, double y, double s_seed, int max_iterations = 4, int *iterations = nullptr) const;
+
+    /**
+     * Same without a seed: starts from the closest of a coarse set of samples.
+     */
+    vector<double> getFrenet(double x, double y, int max_iterations = 4, int *iterations = nullptr) const;
+
+    /**
+     * Both of the above into s and d, without allocating.
+     */
+    void getFrenet(double x, double y, double s_seed, int max_iterations, double &s, double &d,
+                   int *iterations = nullptr) const;
+
+    void getFrenet(double x, double y, int max_iterations, double &s, double &d, int *iterations = nullptr) const;
+
+    /**
+     * Name of the batch kernel picked for this CPU: "avx2", "sse4.1" or "scalar".
+     */
+    static const char *kernel();
+
+    int size() const;
+
+    double step() const;
+
+    double length() const;
+
+    // s of sample 0, 0 unless the line is a piece
+    double begin() const;
+
+    // samples i = 0 .. size(); sample size() repeats sample 0 at s = length()
+    const double *x = nullptr;
+
+    const double *y = nullptr;
+
+    // unit tangent of the line, as cos/sin of the heading
+    const double *cos_heading = nullptr;
+
+    const double *sin_heading = nullptr;
+
+    // unit normal from the map's dx,dy, pointing towards increasing d
+    const double *nx = nullptr;
+
+    const double *ny = nullptr;
+
+private:
+
+    // backing store of the six sample arrays when built rather than attached
+    vector<double> storage;
+
+    int samples = 0;
+
+    double sample_step = 0;
+
+    double inv_step = 0;
+
+    double max_s = 0;
+
+    double inv_max_s = 0;
+
+    double first_s = 0;
+
+    // a piece takes s up to half the rest of the loop before its first sample
+    double wrap_back = 0;
+
+    // s relative to sample 0, wrapped into [-wrap_back, max_s - wrap_back)
+    double local_s(double s) const;
+
+    // sample starting the interval of local s, clamped to the line
+    int sample_of(double u) const;
+
+    // every COARSE_STRIDE-th sample, indexed to seed unseeded projections
+    vector<double> coarse_x;
+
+    vector<double> coarse_y;
+
+    WaypointIndex coarse_index;
+
+    void build_coarse_index();
+};
+
+#endif /* reference_line_hpp */
@@ -0,0 +1,60 @@
+//
+//  road_map.cpp
+//  path_planning
+//
+//  Everything the planner reads about the road, loaded once at startup and
+//  shared read-only by every planner.
+//
+
+#include "road_map.hpp"
+
+#include "frenet.hpp"
+
+
+RoadMap::RoadMap() {}
+
+bool RoadMap::load(const string &bin_file, const string &csv_file, double line_step) {
+
+    if (mapped_map.open(bin_file)) {
+        auto section = [this](MapSection s) {
+            return vector<double>(mapped_map.section(s), mapped_map.section(s) + mapped_map.count(s));
+        };
+        maps_x = section(MAP_X);
+        maps_y = section(MAP_Y);
+        maps_s = section(MAP_S);
+        maps_dx = section(MAP_DX);
+        maps_dy = section(MAP_DY);
+        maps_cum_s = section(MAP_CUM_S);
+        seg_ux = section(MAP_SEG_UX);
+        seg_uy = section(MAP_SEG_UY);
+        max_s = mapped_map.header().max_s;
+        // the reference line reads its samples straight from the mapping
+        line.attach(mapped_map.section(LINE_X), mapped_map.section(LINE_Y),
+                    mapped_map.section(LINE_COS_HEADING), mapped_map.section(LINE_SIN_HEADING),
+                    mapped_map.section(LINE_NX), mapped_map.section(LINE_NY),
+                    mapped_map.header().line_samples - 1, max_s);
+    } else {
+        if (!read_map_csv(csv_file, maps_x, maps_y, maps_s, maps_dx, maps_dy) || maps_x.size() < 2) {
+            return false;
+        }
+        maps_cum_s = cumulativeDistances(maps_x, maps_y);
+        segmentDirections(maps_x, maps_y, seg_ux, seg_uy);
+        line.build(maps_x, maps_y, maps_s, maps_dx, maps_dy, max_s, line_step);
+    }
+
+    index.build(maps_x, maps_y);
+    return true;
+}
+
+bool RoadMap::use_tiles(const string &bin_file) {
+    if (!tiled_map.open(bin_file)) {
+        return false;
+    }
+    max_s = tiled_map.length();
+    tiles = &tiled_map;
+    return true;
+}
+
+bool RoadMap::mapped() const {
+    return mapped_map.is_open();
+}
@@ -0,0 +1,88 @@
+//
+//  road_map.hpp
+//  path_planning
+//
+//  Everything the planner reads about the road, loaded once at startup and
+//  shared read-only by every planner.
+//
+
+#ifndef road_map_hpp
+#define road_map_hpp
+
+#include <string>
+#include <vector>
+#include "map_file.hpp"
+#include "reference_line.hpp"
+#include "tiled_map.hpp"
+#include "waypoint_index.hpp"
+
+using namespace std;
+
+class RoadMap {
+public:
+
+    // waypoint's x,y,s and d normalized normal vectors
+    vector<double> maps_x;
+
+    vector<double> maps_y;
+
+    vector<double> maps_s;
+
+    vector<double> maps_dx;
+
+    vector<double> maps_dy;
+
+    // arc length up to every waypoint, so getFrenet does not sum the map per call
+    vector<double> maps_cum_s;
+
+    // unit direction of every map segment
+    vector<double> seg_ux;
+
+    vector<double> seg_uy;
+
+    // The max s value before wrapping around the track back to 0
+    double max_s = 6945.554;
+
+    // spatial index for nearest/next waypoint lookups in getFrenet
+    WaypointIndex index;
+
+    // smooth, densely sampled lane geometry for Frenet to Cartesian conversion
+    ReferenceLine line;
+
+    // set when the route is read in tiles instead, see use_tiles(); the
+    // waypoint tables, index and line above are then left empty
+    TiledMap *tiles = nullptr;
+
+    /**
+     * Constructor
+     */
+    RoadMap();
+
+    RoadMap(const RoadMap &) = delete;
+    RoadMap &operator=(const RoadMap &) = delete;
+
+    /**
+     * Maps the compiled map file bin_file (see map_compiler) when present and
+     * parses csv_file otherwise, building the derived tables with a reference
+     * line sampled every line_step meters. Returns false if neither loads.
+     */
+    bool load(const string &bin_file, const string &csv_file, double line_step = 0.25);
+
+    /**
+     * Reads the route of bin_file in tiles instead of loading it whole; call
+     * it in place of load(). Planners reach the tiles through their RoadView.
+     * Returns false if the file cannot be read as a tiled map.
+     */
+    bool use_tiles(const string &bin_file);
+
+    // true when load() mapped the compiled file
+    bool mapped() const;
+
+private:
+
+    MappedMap mapped_map;
+
+    TiledMap tiled_map;
+};
+
+#endif /* road_map_hpp */
@@ -0,0 +1,110 @@
+//
+//  road_view.cpp
+//  path_planning
+//
+//  One planner's view of the road: every Frenet and Cartesian conversion it
+//  makes goes through here, against the whole reference line or, with a
+//  tiled map, against the tiles its own window keeps around the ego.
+//
+
+#include "road_view.hpp"
+
+#include <math.h>
+
+
+RoadView::RoadView(const RoadMap &road)
+    : road(road),
+      frenet_tracker(road.maps_x, road.maps_y, road.maps_cum_s, road.index, road.max_s, road.seg_ux, road.seg_uy),
+      xy_cache(road.line) {
+    if (road.tiles) {
+        window.reset(new TileWindow(*road.tiles));
+    }
+}
+
+void RoadView::update(double ego_s) {
+    if (window) {
+        window->update(ego_s);
+    }
+}
+
+void RoadView::getXY(const double *sd, int n, double *xs, double *ys) {
+    if (!window) {
+        xy_cache.getXY(sd, n, xs, ys);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        window->line(sd[2*i]).getXY(sd + 2*i, 1, xs + i, ys + i);
+    }
+}
+
+void RoadView::getFrenet(double x, double y, double hint_s, int max_iterations, double &s, double &d) {
+    if (!window) {
+        road.line.getFrenet(x, y, hint_s, max_iterations, s, d);
+        return;
+    }
+    /* A projection that ends past the seed's tile is run again on the tile
+       it ended in, where the piece is exact rather than extrapolated. */
+    const ReferenceLine *line = &window->line(hint_s);
+    line->getFrenet(x, y, hint_s, max_iterations, s, d);
+    const ReferenceLine *found = &window->line(s);
+    if (found != line) {
+        found->getFrenet(x, y, s, max_iterations, s, d);
+    }
+}
+
+void RoadView::getFrenet(double x, double y, double &s, double &d) {
+    if (!window) {
+        road.line.getFrenet(x, y, 4, s, d);
+        return;
+    }
+    getFrenet(x, y, seed(x, y), 4, s, d);
+}
+
+double RoadView::seed(double x, double y) {
+    /* Every tile held projects from its own samples. Far from the point a
+       piece converges anywhere, so a projection landing on its own tile, give
+       or take a sample, beats one that does not, then the one nearer the line. */
+    double best_s = 0;
+    double best_d = 0;
+    bool best_inside = false;
+    bool first = true;
+    for (const shared_ptr<const MapTile> &tile : window->held()) {
+        double s, d;
+        tile->line.getFrenet(x, y, 4, s, d);
+        double margin = tile->line.step();
+        bool inside = s >= tile->s_begin - margin && s <= tile->s_end + margin;
+        if (first || (inside && !best_inside) || (inside == best_inside && fabs(d) < fabs(best_d))) {
+            best_s = s;
+            best_d = d;
+            best_inside = inside;
+            first = false;
+        }
+    }
+    return best_s;
+}
+
+void RoadView::getFrenet(const int *ids, const double *xs, const double *ys, const double *vxs, const double *vys, int n,
+                         double *s, double *d, double *s_dot, double *d_dot, int newton_iterations) {
+    if (!window) {
+        frenet_tracker.getFrenet(ids, xs, ys, vxs, vys, n, s, d, s_dot, d_dot);
+        // refine onto the smooth reference line, seeded with the waypoint projection
+        for (int i = 0; i < n; i++) {
+            road.line.getFrenet(xs[i], ys[i], s[i], newton_iterations, s[i], d[i]);
+        }
+        return;
+    }
+    /* No waypoints with a tiled map: project on the line straight away and
+       split the velocity along its heading, d to the right as the simulator
+       reports it. */
+    for (int i = 0; i < n; i++) {
+        getFrenet(xs[i], ys[i], seed(xs[i], ys[i]), newton_iterations, s[i], d[i]);
+        double cos_h, sin_h;
+        window->line(s[i]).heading(s[i], cos_h, sin_h);
+        s_dot[i] = vxs[i]*cos_h + vys[i]*sin_h;
+        d_dot[i] = vxs[i]*sin_h - vys[i]*cos_h;
+    }
+}
+
+void RoadView::forget(int id) {
+    frenet_tracker.forget(id);
+}
@@ -0,0 +1,85 @@
+//
+//  road_view.hpp
+//  path_planning
+//
+//  One planner's view of the road: every Frenet and Cartesian conversion it
+//  makes goes through here, against the whole reference line or, with a
+//  tiled map, against the tiles its own window keeps around the ego.
+//
+
+#ifndef road_view_hpp
+#define road_view_hpp
+
+#include <memory>
+#include <vector>
+#include "frenet_tracker.hpp"
+#include "road_map.hpp"
+#include "tiled_map.hpp"
+#include "xy_cache.hpp"
+
+using namespace std;
+
+class RoadView {
+public:
+
+    /**
+     * Constructor. The view holds per-planner state, so every planner needs
+     * its own over the shared road.
+     */
+    RoadView(const RoadMap &road);
+
+    RoadView(const RoadView &) = delete;
+    RoadView &operator=(const RoadView &) = delete;
+
+    /**
+     * Tells the view where the ego is; with a tiled map this moves the window.
+     */
+    void update(double ego_s);
+
+    /**
+     * Batch transform of n interleaved (s,d) pairs into the caller's x and y
+     * arrays.
+     */
+    void getXY(const double *sd, int n, double *xs, double *ys);
+
+    /**
+     * Transform from Cartesian x,y to Frenet s,d on the reference line, with
+     * Newton iterations started from hint_s, see ReferenceLine::getFrenet.
+     * Does not allocate.
+     */
+    void getFrenet(double x, double y, double hint_s, int max_iterations, double &s, double &d);
+
+    /**
+     * Same without a seed.
+     */
+    void getFrenet(double x, double y, double &s, double &d);
+
+    /**
+     * Frenet state of n sensed cars, SoA as FrenetTracker::getFrenet, with s
+     * and d refined on the reference line by newton_iterations.
+     */
+    void getFrenet(const int *ids, const double *xs, const double *ys, const double *vxs, const double *vys, int n,
+                   double *s, double *d, double *s_dot, double *d_dot, int newton_iterations);
+
+    /**
+     * Drops what is remembered of a car that left the sensor range.
+     */
+    void forget(int id);
+
+private:
+
+    const RoadMap &road;
+
+    // whole route: warm-started waypoint projection and cached anchors
+    FrenetTracker frenet_tracker;
+
+    XYCache xy_cache;
+
+    // tiled route: the tiles this planner holds, nullptr otherwise
+    unique_ptr<TileWindow> window;
+
+    // tiled route: s to start an unseeded projection from
+    double seed(double x, double y);
+};
+
+#endif /* road_view_hpp */
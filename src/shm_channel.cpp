@@ -0,0 +1,280 @@
+//
+//  shm_channel.cpp
+//  path_planning
+//
+//  Transport for a simulator on the same host: binary protocol frames are
+//  exchanged through two single-producer single-consumer rings in POSIX shared
+//  memory instead of a TCP websocket. A reader with nothing to read sleeps on
+//  a futex and is woken by the writer.
+//
+
+#include "shm_channel.hpp"
+
+#include <chrono>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+
+// "PPSH" read as a little-endian u32
+static const uint32_t CHANNEL_MAGIC = 0x48535050;
+
+static const uint32_t CHANNEL_VERSION = 1;
+
+// length word telling the reader the rest of the ring is unused: messages
+// are kept contiguous so they can be decoded in place
+static const uint32_t SKIP = 0xffffffff;
+
+// polls of an empty ring before the reader goes to sleep
+static const int SPIN = 2000;
+
+// Start of the shared memory object, followed by the two ring headers and
+// the two rings' bytes
+struct ShmChannelHeader {
+
+    uint32_t magic;
+
+    uint32_t version;
+
+    uint32_t capacity;
+
+    char pad[52];
+
+    ShmRingHeader telemetry;
+
+    ShmRingHeader control;
+};
+
+// every message starts on an 8 byte boundary
+static uint32_t message_bytes(size_t length) {
+    return (uint32_t)((4 + length + 7) & ~(size_t)7);
+}
+
+/* The futex word is the ring's head: the reader sleeps while head still holds
+   the value it saw empty, and the writer wakes it after moving head. Without
+   futexes (macOS) the reader naps briefly instead. */
+static void wait_on(atomic<uint32_t> &word, uint32_t value, int timeout_ms) {
+#ifdef __linux__
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    syscall(SYS_futex, (uint32_t *)&word, FUTEX_WAIT, value, timeout_ms < 0 ? nullptr : &timeout, nullptr, 0);
+#else
+    (void)word;
+    (void)value;
+    (void)timeout_ms;
+    this_thread::sleep_for(chrono::microseconds(50));
+#endif
+}
+
+static void wake(atomic<uint32_t> &word) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *)&word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+bool ShmRing::write(const char *message, size_t length) {
+
+    uint32_t need = message_bytes(length);
+    if (header == nullptr || need > capacity / 2) {
+        full++;
+        return false;
+    }
+
+    uint32_t head = header->head.load(memory_order_relaxed);
+    uint32_t tail = header->tail.load(memory_order_acquire);
+    uint32_t offset = head & (capacity - 1);
+    uint32_t contiguous = capacity - offset;
+    uint32_t total = contiguous < need ? contiguous + need : need;
+    if (capacity - (head - tail) < total) {
+        full++;
+        return false;
+    }
+
+    if (contiguous < need) {
+        memcpy(data + offset, &SKIP, 4);
+        head += contiguous;
+        offset = 0;
+    }
+    uint32_t length32 = (uint32_t)length;
+    memcpy(data + offset, &length32, 4);
+    memcpy(data + offset + 4, message, length);
+
+    /* seq_cst pairs with the reader's store to waiting: either it sees the new
+       head before sleeping, or this load sees it waiting. */
+    header->head.store(head + need, memory_order_seq_cst);
+    if (header->waiting.load(memory_order_seq_cst)) {
+        wake(header->head);
+    }
+    return true;
+}
+
+const char *ShmRing::read(size_t &length, int timeout_ms) {
+
+    if (header == nullptr) {
+        return nullptr;
+    }
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+    int spins = 0;
+    while (true) {
+        uint32_t tail = header->tail.load(memory_order_relaxed);
+        uint32_t head = header->head.load(memory_order_acquire);
+        if (head != tail) {
+            uint32_t offset = tail & (capacity - 1);
+            uint32_t length32;
+            memcpy(&length32, data + offset, 4);
+            if (length32 == SKIP) {
+                header->tail.store(tail + capacity - offset, memory_order_release);
+                continue;
+            }
+            length = length32;
+            pending = message_bytes(length);
+            return data + offset + 4;
+        }
+
+        if (spins < SPIN) {
+            spins++;
+            continue;
+        }
+        int remaining = -1;
+        if (timeout_ms >= 0) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            if (left <= 0) {
+                return nullptr;
+            }
+            remaining = (int)left;
+        }
+        header->waiting.store(1, memory_order_seq_cst);
+        if (header->head.load(memory_order_seq_cst) == tail) {
+            wait_on(header->head, tail, remaining);
+        }
+        header->waiting.store(0, memory_order_relaxed);
+    }
+}
+
+void ShmRing::release() {
+    if (pending) {
+        header->tail.store(header->tail.load(memory_order_relaxed) + pending, memory_order_release);
+        pending = 0;
+    }
+}
+
+void ShmRing::discard() {
+    if (header) {
+        header->tail.store(header->head.load(memory_order_acquire), memory_order_release);
+        pending = 0;
+    }
+}
+
+ShmChannel::ShmChannel() {}
+
+ShmChannel::~ShmChannel() {
+    close();
+}
+
+bool ShmChannel::attach(void *at, size_t length) {
+    ShmChannelHeader *channel = (ShmChannelHeader *)at;
+    uint32_t capacity = channel->capacity;
+    if (channel->magic != CHANNEL_MAGIC || channel->version != CHANNEL_VERSION
+        || capacity == 0 || (capacity & (capacity - 1)) != 0
+        || length < sizeof(ShmChannelHeader) + 2 * (size_t)capacity) {
+        return false;
+    }
+    mapping = at;
+    mapping_length = length;
+    char *rings = (char *)at + sizeof(ShmChannelHeader);
+    telemetry.header = &channel->telemetry;
+    telemetry.data = rings;
+    telemetry.capacity = capacity;
+    control.header = &channel->control;
+    control.data = rings + capacity;
+    control.capacity = capacity;
+    return true;
+}
+
+bool ShmChannel::create(const string &name_, uint32_t capacity) {
+
+    close();
+    if (capacity < 64 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    size_t length = sizeof(ShmChannelHeader) + 2 * (size_t)capacity;
+    void *at = MAP_FAILED;
+    if (ftruncate(fd, length) == 0) {
+        at = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (at == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    // a fresh object is zero filled: rings empty, nobody waiting
+    ShmChannelHeader *channel = (ShmChannelHeader *)at;
+    channel->capacity = capacity;
+    channel->version = CHANNEL_VERSION;
+    atomic_thread_fence(memory_order_release);
+    channel->magic = CHANNEL_MAGIC;
+
+    attach(at, length);
+    name = name_;
+    owner = true;
+    return true;
+}
+
+bool ShmChannel::open(const string &name_) {
+
+    close();
+    int fd = shm_open(name_.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void *at = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ShmChannelHeader)) {
+        at = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (at == MAP_FAILED) {
+        return false;
+    }
+    if (!attach(at, st.st_size)) {
+        munmap(at, st.st_size);
+        return false;
+    }
+    control.discard();
+    name = name_;
+    owner = false;
+    return true;
+}
+
+void ShmChannel::close() {
+    if (mapping) {
+        munmap(mapping, mapping_length);
+        if (owner) {
+            shm_unlink(name.c_str());
+        }
+    }
+    mapping = nullptr;
+    mapping_length = 0;
+    owner = false;
+    telemetry = ShmRing();
+    control = ShmRing();
+}
+
+bool ShmChannel::is_open() const {
+    return mapping != nullptr;
+}
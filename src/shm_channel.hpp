@@ -0,0 +1,135 @@
+//
+//  shm_channel.hpp
+//  path_planning
+//
+//  Transport for a simulator on the same host: binary protocol frames are
+//  exchanged through two single-producer single-consumer rings in POSIX shared
+//  memory instead of a TCP websocket. A reader with nothing to read sleeps on
+//  a futex and is woken by the writer.
+//
+
+#ifndef shm_channel_hpp
+#define shm_channel_hpp
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+// Ring state shared by both processes. head and tail count bytes ever written
+// and read, so head - tail is the fill level even after they wrap around.
+struct ShmRingHeader {
+
+    // advanced by the writer only
+    atomic<uint32_t> head;
+
+    // set while the reader sleeps on head
+    atomic<uint32_t> waiting;
+
+    char pad0[56];
+
+    // advanced by the reader only, on its own cache line
+    atomic<uint32_t> tail;
+
+    char pad1[60];
+};
+
+class ShmRing {
+public:
+
+    // messages refused because the ring was full
+    long full = 0;
+
+    /**
+     * Appends a message of length bytes, waking the reader if it sleeps.
+     * Returns false when the ring has no room for it; nothing is written then.
+     * Writer side only.
+     */
+    bool write(const char *data, size_t length);
+
+    /**
+     * The oldest unread message, in place in the ring, or nullptr if none
+     * arrives within timeout_ms (negative waits forever). The message stays
+     * valid until release(). Reader side only.
+     */
+    const char *read(size_t &length, int timeout_ms);
+
+    // gives the space of the message last returned by read() back to the writer
+    void release();
+
+    // drops every unread message, e.g. left over from a previous peer
+    void discard();
+
+private:
+
+    friend class ShmChannel;
+
+    ShmRingHeader *header = nullptr;
+
+    char *data = nullptr;
+
+    uint32_t capacity = 0;
+
+    // bytes taken by the message returned by read(), 0 when none
+    uint32_t pending = 0;
+};
+
+class ShmChannel {
+public:
+
+    // default bytes per ring, room for about eighty 50 point control frames
+    static const uint32_t DEFAULT_CAPACITY = 1 << 16;
+
+    // simulator to planner, binary telemetry frames
+    ShmRing telemetry;
+
+    // planner to simulator, binary control frames
+    ShmRing control;
+
+    /**
+     * Constructor
+     */
+    ShmChannel();
+
+    /**
+     * Destructor. Unmaps the channel, and unlinks it if this side created it.
+     */
+    ~ShmChannel();
+
+    ShmChannel(const ShmChannel &) = delete;
+    ShmChannel &operator=(const ShmChannel &) = delete;
+
+    /**
+     * Creates the shared memory object name (e.g. "/path_planning") with two
+     * rings of capacity bytes each, a power of two, replacing a stale one.
+     * The planner side.
+     */
+    bool create(const string &name, uint32_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Attaches to a channel made by create(), dropping control frames left
+     * for a previous client. The simulator side.
+     */
+    bool open(const string &name);
+
+    void close();
+
+    bool is_open() const;
+
+private:
+
+    string name;
+
+    void *mapping = nullptr;
+
+    size_t mapping_length = 0;
+
+    // created here, so unlinked on close
+    bool owner = false;
+
+    bool attach(void *mapping, size_t length);
+};
+
+#endif /* shm_channel_hpp */
@@ -0,0 +1,38 @@
+//
+//  simd.cpp
+//  path_planning
+//
+//  Runtime detection of the vector instruction set used by the batch kernels.
+//
+
+#include "simd.hpp"
+
+
+static SimdLevel detect_simd_level() {
+#ifdef PATH_PLANNING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SIMD_SSE41;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+SimdLevel simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+const char *simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2:
+            return "avx2";
+        case SIMD_SSE41:
+            return "sse4.1";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,43 @@
+//
+//  simd.hpp
+//  path_planning
+//
+//  Runtime detection of the vector instruction set used by the batch kernels.
+//
+
+#ifndef simd_hpp
+#define simd_hpp
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PATH_PLANNING_X86
+#endif
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE41,
+    SIMD_AVX2
+};
+
+/**
+ * Best instruction set this CPU supports, detected once on first call.
+ */
+SimdLevel simd_level();
+
+const char *simd_level_name(SimdLevel level);
+
+#ifdef PATH_PLANNING_X86
+
+/**
+ * base[index[k]] for the four lanes. Same as _mm256_i32gather_pd, but with an
+ * explicit zero source so GCC does not warn about an uninitialized register.
+ */
+__attribute__((target("avx2")))
+static inline __m256d gather_pd(const double *base, __m128i index) {
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, index, all, 8);
+}
+
+#endif
+
+#endif /* simd_hpp */
@@ -0,0 +1,81 @@
+//
+//  spsc_queue.hpp
+//  path_planning
+//
+//  Bounded lock-free queue between exactly one producer thread and one
+//  consumer thread. Neither side ever blocks or allocates after construction.
+//
+
+#ifndef spsc_queue_hpp
+#define spsc_queue_hpp
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class SpscQueue {
+public:
+
+    /**
+     * Constructor. capacity is rounded up to a power of two.
+     */
+    explicit SpscQueue(size_t capacity = 1024) {
+        size_t n = 1;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        items.resize(n);
+        mask = n - 1;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // producer side; false when the queue is full
+    bool push(const T &item) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h - tail.load(memory_order_acquire) > mask) {
+            return false;
+        }
+        items[h & mask] = item;
+        head.store(h + 1, memory_order_seq_cst);
+        return true;
+    }
+
+    // consumer side; false when the queue is empty
+    bool pop(T &item) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t == head.load(memory_order_acquire)) {
+            return false;
+        }
+        item = items[t & mask];
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    bool empty() const {
+        return tail.load(memory_order_relaxed) == head.load(memory_order_seq_cst);
+    }
+
+private:
+
+    vector<T> items;
+
+    size_t mask;
+
+    // items ever pushed, written by the producer only
+    atomic<size_t> head{0};
+
+    char pad0[64 - sizeof(atomic<size_t>)];
+
+    // items ever popped, written by the consumer only, on its own cache line
+    atomic<size_t> tail{0};
+
+    char pad1[64 - sizeof(atomic<size_t>)];
+};
+
+#endif /* spsc_queue_hpp */
@@ -0,0 +1,334 @@
+//
+//  telemetry.cpp
+//  path_planning
+//
+//  Decoder for the simulator's socket.io telemetry event. Reads the payload in
+//  place into a fixed-layout frame instead of building a json DOM.
+//
+
+#include "telemetry.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// nesting of unknown values skipped over before the message counts as broken
+static const int MAX_DEPTH = 16;
+
+// longest number literal accepted; the simulator prints at most 17 digits
+static const int MAX_NUMBER = 63;
+
+// Read position within the message; end is one past its last byte
+struct Cursor {
+    const char *p;
+    const char *end;
+};
+
+static void skip_space(Cursor &c) {
+    while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\n' || *c.p == '\r')) {
+        c.p++;
+    }
+}
+
+static bool peek(Cursor &c, char ch) {
+    skip_space(c);
+    return c.p < c.end && *c.p == ch;
+}
+
+static bool expect(Cursor &c, char ch) {
+    if (!peek(c, ch)) {
+        return false;
+    }
+    c.p++;
+    return true;
+}
+
+static bool expect_literal(Cursor &c, const char *literal) {
+    skip_space(c);
+    size_t n = strlen(literal);
+    if ((size_t)(c.end - c.p) < n || memcmp(c.p, literal, n) != 0) {
+        return false;
+    }
+    c.p += n;
+    return true;
+}
+
+// String without unescaping: begin/length cover the raw bytes between the quotes
+static bool parse_string(Cursor &c, const char *&begin, size_t &length) {
+    if (!expect(c, '"')) {
+        return false;
+    }
+    begin = c.p;
+    while (c.p < c.end && *c.p != '"') {
+        c.p += *c.p == '\\' ? 2 : 1;
+    }
+    if (c.p >= c.end) {
+        return false;
+    }
+    length = c.p - begin;
+    c.p++;
+    return true;
+}
+
+static bool string_is(const char *begin, size_t length, const char *text) {
+    return strlen(text) == length && memcmp(begin, text, length) == 0;
+}
+
+// Exact conversion when the digits fit a double's mantissa and the power of ten
+// is itself exact (Clinger's fast path); false leaves the token to strtod.
+static bool fast_number(const char *p, const char *end, double &out) {
+    static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    bool negative = p < end && *p == '-';
+    p += negative ? 1 : 0;
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    bool point = false;
+    // "-", "." and "-." have no digit and are no number
+    bool any_digit = false;
+    for (; p < end; p++) {
+        if (*p >= '0' && *p <= '9') {
+            any_digit = true;
+            mantissa = mantissa * 10 + (*p - '0');
+            scale -= point ? 1 : 0;
+            digits += mantissa != 0 ? 1 : 0;
+        } else if (*p == '.' && !point) {
+            point = true;
+        } else {
+            return false;
+        }
+    }
+    if (!any_digit || digits > 15 || scale < -22) {
+        return false;
+    }
+    double value = scale < 0 ? (double)mantissa / POW10[-scale] : (double)mantissa;
+    out = negative ? -value : value;
+    return true;
+}
+
+static bool parse_number(Cursor &c, double &out) {
+    skip_space(c);
+    const char *begin = c.p;
+    while (c.p < c.end && ((*c.p >= '0' && *c.p <= '9') || *c.p == '-' || *c.p == '+' || *c.p == '.'
+                           || *c.p == 'e' || *c.p == 'E')) {
+        c.p++;
+    }
+    size_t length = c.p - begin;
+    if (length == 0 || length > (size_t)MAX_NUMBER) {
+        return false;
+    }
+
+    if (fast_number(begin, c.p, out)) {
+        return true;
+    }
+
+    /* strtod needs a terminated string, and data is not one: copy the token to
+       the stack, which keeps its correctly rounded conversion. */
+    char token[MAX_NUMBER + 1];
+    memcpy(token, begin, length);
+    token[length] = '\0';
+    char *parsed;
+    out = strtod(token, &parsed);
+    return parsed == token + length;
+}
+
+static bool skip_value(Cursor &c, int depth) {
+    if (depth > MAX_DEPTH) {
+        return false;
+    }
+    skip_space(c);
+    if (c.p >= c.end) {
+        return false;
+    }
+
+    const char *begin;
+    size_t length;
+    double number;
+    switch (*c.p) {
+        case '"':
+            return parse_string(c, begin, length);
+        case '[':
+            c.p++;
+            if (expect(c, ']')) {
+                return true;
+            }
+            do {
+                if (!skip_value(c, depth + 1)) {
+                    return false;
+                }
+            } while (expect(c, ','));
+            return expect(c, ']');
+        case '{':
+            c.p++;
+            if (expect(c, '}')) {
+                return true;
+            }
+            do {
+                if (!parse_string(c, begin, length) || !expect(c, ':') || !skip_value(c, depth + 1)) {
+                    return false;
+                }
+            } while (expect(c, ','));
+            return expect(c, '}');
+        case 't':
+            return expect_literal(c, "true");
+        case 'f':
+            return expect_literal(c, "false");
+        case 'n':
+            return expect_literal(c, "null");
+        default:
+            return parse_number(c, number);
+    }
+}
+
+// [a, b, ...] into out, failing if it holds more than capacity numbers
+static bool parse_number_array(Cursor &c, double *out, int capacity, int &count) {
+    count = 0;
+    if (!expect(c, '[')) {
+        return false;
+    }
+    if (expect(c, ']')) {
+        return true;
+    }
+    do {
+        if (count == capacity || !parse_number(c, out[count])) {
+            return false;
+        }
+        count++;
+    } while (expect(c, ','));
+    return expect(c, ']');
+}
+
+// Number of elements of a flat array, stepping over the bytes of its numbers
+// without converting them
+static bool count_number_array(Cursor &c, int &count) {
+    count = 0;
+    if (!expect(c, '[')) {
+        return false;
+    }
+    if (expect(c, ']')) {
+        return true;
+    }
+    count = 1;
+    const char *p = (const char *)memchr(c.p, ']', c.end - c.p);
+    if (p == nullptr) {
+        return false;
+    }
+    for (const char *q = c.p; q < p; q++) {
+        count += *q == ',' ? 1 : 0;
+    }
+    c.p = p + 1;
+    return true;
+}
+
+// [[id, x, y, vx, vy, s, d], ...] into the frame's car arrays
+static bool parse_sensor_fusion(Cursor &c, TelemetryFrame &frame) {
+    frame.n_cars = 0;
+    if (!expect(c, '[')) {
+        return false;
+    }
+    if (expect(c, ']')) {
+        return true;
+    }
+    do {
+        int i = frame.n_cars;
+        double values[7];
+        int count;
+        if (i == TELEMETRY_MAX_CARS || !parse_number_array(c, values, 7, count) || count != 7) {
+            return false;
+        }
+        frame.car_id[i] = (int)values[0];
+        frame.car_x[i] = values[1];
+        frame.car_y[i] = values[2];
+        frame.car_vx[i] = values[3];
+        frame.car_vy[i] = values[4];
+        frame.car_s[i] = values[5];
+        frame.car_d[i] = values[6];
+        frame.n_cars++;
+    } while (expect(c, ','));
+    return expect(c, ']');
+}
+
+TelemetryStatus decode_telemetry(const char *data, size_t length, TelemetryFrame &frame, TelemetryPathMode path_mode) {
+
+    // "42" at the start of the message means there's a websocket message event.
+    // The 4 signifies a websocket message
+    // The 2 signifies a websocket event
+    if (length <= 2 || data[0] != '4' || data[1] != '2') {
+        return TELEMETRY_IGNORED;
+    }
+    Cursor c = {data + 2, data + length};
+
+    const char *event;
+    size_t event_length;
+    if (!expect(c, '[') || !parse_string(c, event, event_length)) {
+        return TELEMETRY_MALFORMED;
+    }
+    if (!expect(c, ',') || peek(c, 'n')) {
+        return TELEMETRY_MANUAL;
+    }
+    if (!string_is(event, event_length, "telemetry")) {
+        return TELEMETRY_IGNORED;
+    }
+
+    frame.x = frame.y = frame.s = frame.d = frame.yaw = frame.speed = 0;
+    frame.end_path_s = frame.end_path_d = 0;
+    frame.path_size = frame.n_cars = 0;
+    int path_y_size = 0;
+
+    if (!expect(c, '{')) {
+        return TELEMETRY_MALFORMED;
+    }
+    if (!expect(c, '}')) {
+        do {
+            const char *key;
+            size_t key_length;
+            if (!parse_string(c, key, key_length) || !expect(c, ':')) {
+                return TELEMETRY_MALFORMED;
+            }
+
+            bool ok;
+            if (string_is(key, key_length, "x")) {
+                ok = parse_number(c, frame.x);
+            } else if (string_is(key, key_length, "y")) {
+                ok = parse_number(c, frame.y);
+            } else if (string_is(key, key_length, "s")) {
+                ok = parse_number(c, frame.s);
+            } else if (string_is(key, key_length, "d")) {
+                ok = parse_number(c, frame.d);
+            } else if (string_is(key, key_length, "yaw")) {
+                ok = parse_number(c, frame.yaw);
+            } else if (string_is(key, key_length, "speed")) {
+                ok = parse_number(c, frame.speed);
+            } else if (string_is(key, key_length, "previous_path_x")) {
+                ok = path_mode == TELEMETRY_PATH_SIZE ? count_number_array(c, frame.path_size)
+                   : parse_number_array(c, frame.previous_path_x, TELEMETRY_MAX_PATH, frame.path_size);
+            } else if (string_is(key, key_length, "previous_path_y")) {
+                ok = path_mode == TELEMETRY_PATH_SIZE ? count_number_array(c, path_y_size)
+                   : parse_number_array(c, frame.previous_path_y, TELEMETRY_MAX_PATH, path_y_size);
+            } else if (string_is(key, key_length, "end_path_s")) {
+                ok = parse_number(c, frame.end_path_s);
+            } else if (string_is(key, key_length, "end_path_d")) {
+                ok = parse_number(c, frame.end_path_d);
+            } else if (string_is(key, key_length, "sensor_fusion")) {
+                ok = parse_sensor_fusion(c, frame);
+            } else {
+                ok = skip_value(c, 0);
+            }
+            if (!ok) {
+                return TELEMETRY_MALFORMED;
+            }
+        } while (expect(c, ','));
+
+        if (!expect(c, '}')) {
+            return TELEMETRY_MALFORMED;
+        }
+    }
+
+    if (path_y_size != frame.path_size || !expect(c, ']')) {
+        return TELEMETRY_MALFORMED;
+    }
+    return TELEMETRY_OK;
+}
@@ -0,0 +1,74 @@
+//
+//  telemetry.hpp
+//  path_planning
+//
+//  Decoder for the simulator's socket.io telemetry event. Reads the payload in
+//  place into a fixed-layout frame instead of building a json DOM.
+//
+
+#ifndef telemetry_hpp
+#define telemetry_hpp
+
+#include <stddef.h>
+
+using namespace std;
+
+// Capacity of the frame arrays. The simulator reports about a dozen cars and
+// returns at most the points the planner sent, 50 at most.
+const int TELEMETRY_MAX_CARS = 64;
+
+const int TELEMETRY_MAX_PATH = 256;
+
+enum TelemetryStatus {
+    TELEMETRY_OK,           // telemetry event decoded into the frame
+    TELEMETRY_MANUAL,       // event without data: the simulator is in manual mode
+    TELEMETRY_IGNORED,      // not a "42" event message, or another event
+    TELEMETRY_MALFORMED     // broken json, or more cars / path points than fit
+};
+
+// How previous_path_x/y are decoded
+enum TelemetryPathMode {
+    TELEMETRY_PATH_VALUES,  // parse the points into previous_path_x/y
+    TELEMETRY_PATH_SIZE     // only count them; the planner keeps its own copy, see EmittedPath
+};
+
+struct TelemetryFrame {
+
+    // Main car's localization data
+    double x;
+    double y;
+    double s;
+    double d;
+    double yaw;             // [deg]
+    double speed;           // [mph]
+
+    // Previous path data given to the planner, minus the points already driven.
+    // The points are left untouched in TELEMETRY_PATH_SIZE mode.
+    int path_size;
+    double previous_path_x[TELEMETRY_MAX_PATH];
+    double previous_path_y[TELEMETRY_MAX_PATH];
+
+    // Previous path's end s and d values
+    double end_path_s;
+    double end_path_d;
+
+    // Sensor fusion, one entry per car on the same side of the road
+    int n_cars;
+    int car_id[TELEMETRY_MAX_CARS];
+    double car_x[TELEMETRY_MAX_CARS];
+    double car_y[TELEMETRY_MAX_CARS];
+    double car_vx[TELEMETRY_MAX_CARS];
+    double car_vy[TELEMETRY_MAX_CARS];
+    double car_s[TELEMETRY_MAX_CARS];
+    double car_d[TELEMETRY_MAX_CARS];
+};
+
+/**
+ * Decodes a websocket message of length bytes, e.g. 42["telemetry",{...}].
+ * data need not be NUL-terminated and is not modified. Missing fields are left
+ * at zero. Does not allocate.
+ */
+TelemetryStatus decode_telemetry(const char *data, size_t length, TelemetryFrame &frame,
+                                 TelemetryPathMode path_mode = TELEMETRY_PATH_VALUES);
+
+#endif /* telemetry_hpp */
@@ -0,0 +1,194 @@
+//
+//  telemetry_bench.cpp
+//  path_planning
+//
+//  Latency of decode_telemetry against the json path the planner used before:
+//  a std::string copy, hasData, json::parse and per-field lookups. Counts heap
+//  allocations per message as well, and times the decoder again when it only
+//  counts the previous path points (see EmittedPath), and the binary protocol
+//  decoding the same telemetry and encoding a control frame.
+//
+//  Usage: telemetry_bench [messages] [digits]
+//
+
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "binary_protocol.hpp"
+#include "control_writer.hpp"
+#include "json.hpp"
+#include "telemetry.hpp"
+
+using namespace std;
+
+using json = nlohmann::json;
+
+static long allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+// The planner's former check for json data in a socket.io event
+static string hasData(string s) {
+    auto found_null = s.find("null");
+    auto b1 = s.find_first_of("[");
+    auto b2 = s.find_first_of("}");
+    if (found_null != string::npos) {
+        return "";
+    } else if (b1 != string::npos && b2 != string::npos) {
+        return s.substr(b1, b2 - b1 + 2);
+    }
+    return "";
+}
+
+// Telemetry as the simulator sends it: 12 cars and 38 points of previous path,
+// printed with the given significant digits
+static string sample_message(int digits) {
+    ostringstream out;
+    out.precision(digits);
+    out << "42[\"telemetry\",{\"x\":909.48,\"y\":1128.67,\"yaw\":0,\"speed\":43.18921,"
+        << "\"s\":124.8336,\"d\":6.164833,\"previous_path_x\":[";
+    for (int i = 0; i < 38; i++) {
+        out << (i ? "," : "") << 909.48 + i * 0.4123456789012345;
+    }
+    out << "],\"previous_path_y\":[";
+    for (int i = 0; i < 38; i++) {
+        out << (i ? "," : "") << 1128.67 + i * 0.0012345678901234;
+    }
+    out << "],\"end_path_s\":140.5126,\"end_path_d\":6.001592,\"sensor_fusion\":[";
+    for (int i = 0; i < 12; i++) {
+        out << (i ? "," : "") << "[" << i << "," << 775.99 + i * 31.7 << "," << 1421.6 - i * 7.3 << ","
+            << 19.76 + i * 0.31 << "," << 0.1 * i << "," << 6641.6 - i * 123.4 << "," << 2 + (i % 3) * 4.01 << "]";
+    }
+    out << "]}]";
+    return out.str();
+}
+
+int main(int argc, char **argv) {
+
+    int messages = argc > 1 ? atoi(argv[1]) : 100000;
+    int digits = argc > 2 ? atoi(argv[2]) : 17;
+    string message = sample_message(digits);
+    vector<char> data(message.begin(), message.end());
+    data.push_back('\0');   // the json path reads up to the terminator, not length
+
+    TelemetryFrame frame;
+    double checksum = 0;
+
+    long json_allocations = allocations;
+    auto start = chrono::steady_clock::now();
+    for (int m = 0; m < messages; m++) {
+        auto s = hasData(data.data());
+        auto j = json::parse(s);
+        string event = j[0].get<string>();
+        if (event == "telemetry") {
+            double car_x = j[1]["x"];
+            double car_s = j[1]["s"];
+            auto previous_path_x = j[1]["previous_path_x"];
+            auto previous_path_y = j[1]["previous_path_y"];
+            double end_path_s = j[1]["end_path_s"];
+            auto sensor_fusion = j[1]["sensor_fusion"];
+            int n_cars = sensor_fusion.size();
+            for (int i = 0; i < n_cars; i++) {
+                double x = sensor_fusion[i][1];
+                double vx = sensor_fusion[i][3];
+                checksum += x + vx;
+            }
+            double last_x = previous_path_x[previous_path_x.size() - 1];
+            double last_y = previous_path_y[previous_path_y.size() - 1];
+            checksum += car_x + car_s + end_path_s + last_x + last_y;
+        }
+    }
+    double json_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / messages;
+    json_allocations = allocations - json_allocations;
+
+    long decoder_allocations = allocations;
+    start = chrono::steady_clock::now();
+    for (int m = 0; m < messages; m++) {
+        if (decode_telemetry(data.data(), message.size(), frame) == TELEMETRY_OK) {
+            for (int i = 0; i < frame.n_cars; i++) {
+                checksum += frame.car_x[i] + frame.car_vx[i];
+            }
+            checksum += frame.x + frame.s + frame.end_path_s
+                      + frame.previous_path_x[frame.path_size - 1] + frame.previous_path_y[frame.path_size - 1];
+        }
+    }
+    double decoder_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / messages;
+    decoder_allocations = allocations - decoder_allocations;
+
+    long size_only_allocations = allocations;
+    start = chrono::steady_clock::now();
+    for (int m = 0; m < messages; m++) {
+        if (decode_telemetry(data.data(), message.size(), frame, TELEMETRY_PATH_SIZE) == TELEMETRY_OK) {
+            for (int i = 0; i < frame.n_cars; i++) {
+                checksum += frame.car_x[i] + frame.car_vx[i];
+            }
+            checksum += frame.x + frame.s + frame.end_path_s + frame.path_size;
+        }
+    }
+    double size_only_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / messages;
+    size_only_allocations = allocations - size_only_allocations;
+
+    vector<char> binary;
+    encode_binary_telemetry(frame, 1, binary);
+    long binary_allocations = allocations;
+    start = chrono::steady_clock::now();
+    uint32_t sequence;
+    for (int m = 0; m < messages; m++) {
+        if (decode_binary_telemetry(binary.data(), binary.size(), frame, sequence) == TELEMETRY_OK) {
+            for (int i = 0; i < frame.n_cars; i++) {
+                checksum += frame.car_x[i] + frame.car_vx[i];
+            }
+            checksum += frame.x + frame.s + frame.end_path_s + frame.path_size;
+        }
+    }
+    double binary_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / messages;
+    binary_allocations = allocations - binary_allocations;
+
+    // a 50 point control path, as text and as a binary frame
+    double next_x[50], next_y[50];
+    for (int i = 0; i < 50; i++) {
+        next_x[i] = 909.48 + i * 0.4123456789012345;
+        next_y[i] = 1128.67 + i * 0.0012345678901234;
+    }
+    ControlWriter text_writer;
+    BinaryControlWriter binary_writer;
+    start = chrono::steady_clock::now();
+    for (int m = 0; m < messages; m++) {
+        text_writer.write(next_x, next_y, 50);
+        checksum += text_writer.size();
+    }
+    double text_control_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / messages;
+    start = chrono::steady_clock::now();
+    for (int m = 0; m < messages; m++) {
+        binary_writer.write(next_x, next_y, 50, m);
+        checksum += binary_writer.size();
+    }
+    double binary_control_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / messages;
+
+    printf("message: %zu bytes, %d cars, %d path points\n", message.size(), frame.n_cars, frame.path_size);
+    printf("json:    %9.0f ns/message %7.1f allocations/message\n", json_ns, (double)json_allocations / messages);
+    printf("decoder: %9.0f ns/message %7.1f allocations/message\n", decoder_ns, (double)decoder_allocations / messages);
+    printf("size only:%9.0f ns/message %7.1f allocations/message\n", size_only_ns, (double)size_only_allocations / messages);
+    printf("binary:  %9.0f ns/message %7.1f allocations/message (%zu bytes)\n", binary_ns,
+           (double)binary_allocations / messages, binary.size());
+    printf("control: %9.0f ns text (%zu bytes) %6.0f ns binary (%zu bytes)\n", text_control_ns, text_writer.size(),
+           binary_control_ns, binary_writer.size());
+    printf("speedup: %.1fx, binary %.1fx (checksum %g)\n", json_ns / decoder_ns, decoder_ns / binary_ns, checksum);
+    return 0;
+}
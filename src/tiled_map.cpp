@@ -0,0 +1,351 @@
+//
+//  tiled_map.cpp
+//  path_planning
+//
+//  Map store for routes too long to keep in memory. The reference line of the
+//  compiled map file is split into fixed-length s tiles; every planner keeps
+//  the tiles around its own ego resident through a TileWindow, and tiles
+//  ahead of it are prefetched on a background thread.
+//
+
+#include "tiled_map.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+TiledMap::TiledMap() : hits(0), misses(0), prefetched(0) {}
+
+TiledMap::~TiledMap() {
+    close();
+}
+
+bool TiledMap::open(const string &path, double tile_length, int capacity, int prefetch_ahead, bool looped) {
+
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MapFileHeader)
+        || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+        || !valid_map_header(header, (size_t)st.st_size) || header.line_samples < 2
+        || !(header.line_step > 0) || tile_length <= 0) {
+        close();
+        return false;
+    }
+
+    this->tile_length = tile_length;
+    this->capacity = max(capacity, 1);
+    this->prefetch_ahead = max(prefetch_ahead, 0);
+    this->looped = looped;
+
+    /* The first tile doubles as a check that the samples can be read. */
+    first_tile = load(0);
+    if (!first_tile) {
+        close();
+        return false;
+    }
+    insert(first_tile);
+
+    stopping = false;
+    prefetcher = thread(&TiledMap::prefetch_loop, this);
+    return true;
+}
+
+void TiledMap::close() {
+
+    if (prefetcher.joinable()) {
+        {
+            lock_guard<mutex> lock(tiles_mutex);
+            stopping = true;
+        }
+        prefetch_cv.notify_all();
+        prefetcher.join();
+    }
+
+    lock_guard<mutex> lock(tiles_mutex);
+    lru.clear();
+    resident_tiles.clear();
+    loaded_tiles.clear();
+    prefetch_queue.clear();
+    first_tile.reset();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+shared_ptr<const MapTile> TiledMap::tile(int id) {
+
+    {
+        lock_guard<mutex> lock(tiles_mutex);
+        shared_ptr<const MapTile> found = find_locked(id);
+        if (found) {
+            hits++;
+            return found;
+        }
+    }
+
+    /* Load outside the lock so a miss does not stall the prefetch thread. */
+    misses++;
+    shared_ptr<const MapTile> loaded = load(id);
+    if (!loaded) {
+        return loaded;
+    }
+
+    lock_guard<mutex> lock(tiles_mutex);
+    shared_ptr<const MapTile> found = find_locked(id);
+    if (found) {
+        return found;
+    }
+    insert(loaded);
+    return loaded;
+}
+
+shared_ptr<const MapTile> TiledMap::cached(int id) {
+    lock_guard<mutex> lock(tiles_mutex);
+    return find_locked(id);
+}
+
+void TiledMap::prefetch(int id) {
+    {
+        lock_guard<mutex> lock(tiles_mutex);
+        if (resident_tiles.count(id) != 0
+            || find(prefetch_queue.begin(), prefetch_queue.end(), id) != prefetch_queue.end()) {
+            return;
+        }
+        prefetch_queue.push_back(id);
+    }
+    prefetch_cv.notify_one();
+}
+
+int TiledMap::lookahead() const {
+    return prefetch_ahead;
+}
+
+bool TiledMap::is_looped() const {
+    return looped;
+}
+
+double TiledMap::length() const {
+    return header.max_s;
+}
+
+int TiledMap::tile_count() const {
+    return max(1, (int)ceil(header.max_s / tile_length));
+}
+
+int TiledMap::resident() const {
+    lock_guard<mutex> lock(tiles_mutex);
+    return (int)lru.size();
+}
+
+double TiledMap::wrap(double s) const {
+
+    double max_s = header.max_s;
+    if (looped) {
+        s -= floor(s / max_s) * max_s;
+        return s < max_s ? s : 0;
+    }
+    return min(max(s, 0.0), max_s);
+}
+
+int TiledMap::tile_of(double s) const {
+
+    int id = (int)(wrap(s) / tile_length);
+    return min(max(id, 0), tile_count() - 1);
+}
+
+shared_ptr<const MapTile> TiledMap::find_locked(int id) {
+
+    auto found = resident_tiles.find(id);
+    if (found != resident_tiles.end()) {
+        lru.splice(lru.begin(), lru, found->second);
+        return *found->second;
+    }
+
+    /* Evicted from the cache but still held by a window: cache it again
+       rather than reading a second copy. */
+    auto held = loaded_tiles.find(id);
+    if (held != loaded_tiles.end()) {
+        shared_ptr<const MapTile> tile = held->second.lock();
+        if (tile) {
+            insert(tile);
+            return tile;
+        }
+        loaded_tiles.erase(held);
+    }
+    return nullptr;
+}
+
+shared_ptr<const MapTile> TiledMap::load(int id) const {
+
+    shared_ptr<MapTile> t = make_shared<MapTile>();
+    t->id = id;
+    t->s_begin = id * tile_length;
+    t->s_end = min(t->s_begin + tile_length, header.max_s);
+
+    /* Samples covering [s_begin, s_end], plus one on either side. The file's
+       line closes on a repeat of its first sample, so none is borrowed
+       across the seam. */
+    double step = header.line_step;
+    int last_sample = (int)header.line_samples - 1;
+    int first = max((int)floor(t->s_begin / step) - 1, 0);
+    int last = min((int)ceil(t->s_end / step) + 1, last_sample);
+    int count = last - first + 1;
+    if (count < 2) {
+        return nullptr;
+    }
+
+    t->samples.resize(6 * count);
+    double *columns[6];
+    for (int i = 0; i < 6; i++) {
+        columns[i] = t->samples.data() + i * count;
+        if (!read_section((MapSection)(LINE_X + i), first, count, columns[i])) {
+            return nullptr;
+        }
+    }
+
+    t->line.attach_piece(columns[0], columns[1], columns[2], columns[3], columns[4], columns[5],
+                         count - 1, step, first * step, header.max_s);
+    return t;
+}
+
+void TiledMap::insert(const shared_ptr<const MapTile> &tile) {
+
+    lru.push_front(tile);
+    resident_tiles[tile->id] = lru.begin();
+    loaded_tiles[tile->id] = tile;
+    while ((int)lru.size() > capacity) {
+        /* Tiles still held by a caller stay alive through their shared_ptr. */
+        resident_tiles.erase(lru.back()->id);
+        lru.pop_back();
+    }
+}
+
+bool TiledMap::read_section(MapSection section, int first, int count, double *out) const {
+
+    size_t bytes = (size_t)count * sizeof(double);
+    off_t offset = (off_t)(header.offset[section] + (uint64_t)first * sizeof(double));
+    return pread(fd, out, bytes, offset) == (ssize_t)bytes;
+}
+
+void TiledMap::prefetch_loop() {
+
+    unique_lock<mutex> lock(tiles_mutex);
+    while (true) {
+        prefetch_cv.wait(lock, [this] { return stopping || !prefetch_queue.empty(); });
+        if (stopping) {
+            return;
+        }
+
+        int id = prefetch_queue.front();
+        prefetch_queue.pop_front();
+        if (resident_tiles.count(id) != 0) {
+            continue;
+        }
+
+        lock.unlock();
+        shared_ptr<const MapTile> loaded = load(id);
+        lock.lock();
+
+        // a tile that cannot be read is left to the caller's thread to fail on
+        if (loaded && !find_locked(id)) {
+            insert(loaded);
+            prefetched++;
+        }
+    }
+}
+
+TileWindow::TileWindow(TiledMap &map) : map(map) {
+    tiles.reserve(map.lookahead() + 4);
+    wanted.reserve(map.lookahead() + 2);
+    hold(map.tile(0));
+}
+
+void TileWindow::hold(const shared_ptr<const MapTile> &tile) {
+    if (tile) {
+        tiles.push_back(tile);
+    }
+}
+
+void TileWindow::update(double ego_s) {
+
+    int count = map.tile_count();
+    int ego = map.tile_of(ego_s);
+    wanted.clear();
+    for (int i = -1; i <= map.lookahead(); i++) {
+        int id = ego + i;
+        if (map.is_looped()) {
+            id = (id + count) % count;
+        } else if (id < 0 || id >= count) {
+            continue;
+        }
+        if (find(wanted.begin(), wanted.end(), id) == wanted.end()) {
+            wanted.push_back(id);
+        }
+    }
+
+    /* Let go of the tiles left behind, but never of the last one: line()
+       falls back on it. */
+    for (size_t k = 0; k < tiles.size() && tiles.size() > 1;) {
+        if (find(wanted.begin(), wanted.end(), tiles[k]->id) == wanted.end()) {
+            tiles[k] = tiles.back();
+            tiles.pop_back();
+        } else {
+            k++;
+        }
+    }
+
+    for (int id : wanted) {
+        bool held = false;
+        for (const shared_ptr<const MapTile> &tile : tiles) {
+            held = held || tile->id == id;
+        }
+        if (held) {
+            continue;
+        }
+        shared_ptr<const MapTile> tile = map.cached(id);
+        if (tile) {
+            hold(tile);
+        } else {
+            map.prefetch(id);
+        }
+    }
+}
+
+const ReferenceLine &TileWindow::line(double s) {
+
+    int id = map.tile_of(s);
+    for (const shared_ptr<const MapTile> &tile : tiles) {
+        if (tile->id == id) {
+            return tile->line;
+        }
+    }
+
+    shared_ptr<const MapTile> loaded = map.tile(id);
+    if (loaded) {
+        hold(loaded);
+        return loaded->line;
+    }
+
+    const MapTile *nearest = tiles[0].get();
+    for (const shared_ptr<const MapTile> &tile : tiles) {
+        if (abs(tile->id - id) < abs(nearest->id - id)) {
+            nearest = tile.get();
+        }
+    }
+    return nearest->line;
+}
+
+const vector<shared_ptr<const MapTile>> &TileWindow::held() const {
+    return tiles;
+}
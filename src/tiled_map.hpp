@@ -0,0 +1,196 @@
+//
+//  tiled_map.hpp
+//  path_planning
+//
+//  Map store for routes too long to keep in memory. The reference line of the
+//  compiled map file is split into fixed-length s tiles; every planner keeps
+//  the tiles around its own ego resident through a TileWindow, and tiles
+//  ahead of it are prefetched on a background thread.
+//
+
+#ifndef tiled_map_hpp
+#define tiled_map_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "map_file.hpp"
+#include "reference_line.hpp"
+
+using namespace std;
+
+// Reference line samples of one tile, with one extra sample on either side
+// so interpolation near its ends never leaves it.
+struct MapTile {
+
+    int id;
+
+    double s_begin;
+
+    double s_end;
+
+    // the six sample columns of the line, back to back
+    vector<double> samples;
+
+    // piece of the reference line over samples
+    ReferenceLine line;
+};
+
+class TiledMap {
+public:
+
+    // tiles served from the cache / loaded on the caller's thread / loaded ahead
+    atomic<long> hits;
+
+    atomic<long> misses;
+
+    atomic<long> prefetched;
+
+    /**
+     * Constructor
+     */
+    TiledMap();
+
+    /**
+     * Destructor
+     */
+    virtual ~TiledMap();
+
+    TiledMap(const TiledMap &) = delete;
+    TiledMap &operator=(const TiledMap &) = delete;
+
+    /**
+     * Opens a compiled map file (see map_compiler), reads its first tile and
+     * starts the prefetch thread. Returns false if the file is invalid or the
+     * tile cannot be read. looped maps wrap s at max_s; open routes clamp it.
+     * Caches at most capacity tiles no window holds, and windows prefetch
+     * prefetch_ahead tiles past their ego.
+     */
+    bool open(const string &path, double tile_length = 1000, int capacity = 8, int prefetch_ahead = 2, bool looped = true);
+
+    void close();
+
+    /**
+     * Tile id, read on the caller's thread unless resident. nullptr if it
+     * cannot be read.
+     */
+    shared_ptr<const MapTile> tile(int id);
+
+    // tile id if resident, else nullptr; never reads
+    shared_ptr<const MapTile> cached(int id);
+
+    // queues tile id for the prefetch thread
+    void prefetch(int id);
+
+    // tile holding s
+    int tile_of(double s) const;
+
+    // tiles a window keeps past the ego's
+    int lookahead() const;
+
+    bool is_looped() const;
+
+    double length() const;
+
+    int tile_count() const;
+
+    int resident() const;
+
+private:
+
+    int fd = -1;
+
+    MapFileHeader header;
+
+    bool looped = true;
+
+    double tile_length = 1000;
+
+    int capacity = 8;
+
+    int prefetch_ahead = 2;
+
+    // least recently used tile at the back
+    list<shared_ptr<const MapTile>> lru;
+
+    unordered_map<int, list<shared_ptr<const MapTile>>::iterator> resident_tiles;
+
+    // every tile loaded, alive while the cache or a window holds it
+    unordered_map<int, weak_ptr<const MapTile>> loaded_tiles;
+
+    // tile 0 stays loaded, so a new window always has a piece to fall back on
+    shared_ptr<const MapTile> first_tile;
+
+    mutable mutex tiles_mutex;
+
+    deque<int> prefetch_queue;
+
+    condition_variable prefetch_cv;
+
+    bool stopping = false;
+
+    thread prefetcher;
+
+    double wrap(double s) const;
+
+    shared_ptr<const MapTile> load(int id) const;
+
+    // tiles_mutex held: the tile from the cache or a window, else nullptr
+    shared_ptr<const MapTile> find_locked(int id);
+
+    void insert(const shared_ptr<const MapTile> &tile);
+
+    bool read_section(MapSection section, int first, int count, double *out) const;
+
+    void prefetch_loop();
+};
+
+// Tiles one planner keeps resident around its ego. Each session has its own,
+// so sessions far apart on the route never evict each other's tiles; the
+// TiledMap behind them is shared. Not thread-safe, like the planner owning it.
+class TileWindow {
+public:
+
+    /**
+     * Constructor. Holds the map's first tile until update() is called.
+     */
+    TileWindow(TiledMap &map);
+
+    TileWindow(const TileWindow &) = delete;
+    TileWindow &operator=(const TileWindow &) = delete;
+
+    /**
+     * Keeps the tiles from one behind the ego to lookahead() past it, taking
+     * those already resident and queueing the others for prefetch.
+     */
+    void update(double ego_s);
+
+    /**
+     * Reference line piece holding s, read on this thread if the window does
+     * not hold it. If it cannot be read, the nearest piece held extrapolates.
+     */
+    const ReferenceLine &line(double s);
+
+    // tiles held, in no order
+    const vector<shared_ptr<const MapTile>> &held() const;
+
+private:
+
+    TiledMap &map;
+
+    vector<shared_ptr<const MapTile>> tiles;
+
+    // ids the last update() asked for
+    vector<int> wanted;
+
+    void hold(const shared_ptr<const MapTile> &tile);
+};
+
+#endif /* tiled_map_hpp */
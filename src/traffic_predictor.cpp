@@ -0,0 +1,132 @@
+//
+//  traffic_predictor.cpp
+//  path_planning
+//
+//  Rolls every sensed car forward over the planning horizon in Frenet
+//  coordinates, under a constant velocity or constant acceleration model.
+//  The result is time-major, so the cars at one instant are contiguous and
+//  the rollout vectorizes across cars.
+//
+
+#include "traffic_predictor.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include "simd.hpp"
+
+// cars per vector of the widest kernel; rows are padded to it
+static const int LANES = 4;
+
+// t_stop of a car that never stops within the horizon
+static const double NEVER = 1e300;
+
+// Raw view of the padded inputs handed to the rollout kernels
+struct RolloutInputs {
+    const double *s, *d, *v, *d_dot, *a, *t_stop;
+    int stride, rows;
+    double dt, max_s, inv_max_s;
+};
+
+typedef void (*RolloutKernel)(const RolloutInputs &in, double *s, double *d, double *v);
+
+static void rollout_scalar(const RolloutInputs &in, double *s, double *d, double *v) {
+    for (int k = 0; k < in.rows; k++) {
+        double t = k * in.dt;
+        int row = k * in.stride;
+        for (int i = 0; i < in.stride; i++) {
+            // motion stops at t_stop instead of reversing
+            double moving = min(t, in.t_stop[i]);
+            double next_s = in.s[i] + moving * (in.v[i] + 0.5 * in.a[i] * moving);
+            s[row + i] = next_s - floor(next_s * in.inv_max_s) * in.max_s;
+            d[row + i] = in.d[i] + in.d_dot[i] * t;
+            v[row + i] = in.v[i] + in.a[i] * moving;
+        }
+    }
+}
+
+#ifdef PATH_PLANNING_X86
+
+__attribute__((target("avx2")))
+static void rollout_avx2(const RolloutInputs &in, double *s, double *d, double *v) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d max_s = _mm256_set1_pd(in.max_s);
+    const __m256d inv_max_s = _mm256_set1_pd(in.inv_max_s);
+
+    for (int k = 0; k < in.rows; k++) {
+        __m256d t = _mm256_set1_pd(k * in.dt);
+        int row = k * in.stride;
+        for (int i = 0; i < in.stride; i += LANES) {
+            __m256d v0 = _mm256_loadu_pd(in.v + i);
+            __m256d a = _mm256_loadu_pd(in.a + i);
+            __m256d moving = _mm256_min_pd(t, _mm256_loadu_pd(in.t_stop + i));
+
+            __m256d next_s = _mm256_add_pd(_mm256_loadu_pd(in.s + i),
+                                           _mm256_mul_pd(moving, _mm256_add_pd(v0, _mm256_mul_pd(_mm256_mul_pd(half, a), moving))));
+            next_s = _mm256_sub_pd(next_s, _mm256_mul_pd(_mm256_floor_pd(_mm256_mul_pd(next_s, inv_max_s)), max_s));
+
+            _mm256_storeu_pd(s + row + i, next_s);
+            _mm256_storeu_pd(d + row + i, _mm256_add_pd(_mm256_loadu_pd(in.d + i), _mm256_mul_pd(_mm256_loadu_pd(in.d_dot + i), t)));
+            _mm256_storeu_pd(v + row + i, _mm256_add_pd(v0, _mm256_mul_pd(a, moving)));
+        }
+    }
+}
+
+#endif
+
+static RolloutKernel rollout_kernel() {
+#ifdef PATH_PLANNING_X86
+    if (simd_level() == SIMD_AVX2) {
+        return rollout_avx2;
+    }
+#endif
+    return rollout_scalar;
+}
+
+
+int PredictionTensor::row_at(double t) const {
+    int row = dt > 0 ? (int)lround(t / dt) : 0;
+    return max(0, min(steps, row));
+}
+
+TrafficPredictor::TrafficPredictor(int steps, double dt) : steps(steps), dt(dt) {}
+
+void TrafficPredictor::predict(const double *s, const double *d, const double *s_dot, const double *d_dot,
+                               const double *s_ddot, int n, MotionModel model, double max_s, PredictionTensor &out) {
+
+    int stride = (n + LANES - 1) / LANES * LANES;
+    out.steps = steps;
+    out.cars = n;
+    out.stride = stride;
+    out.dt = dt;
+    out.s.resize(out.rows() * stride);
+    out.d.resize(out.rows() * stride);
+    out.v.resize(out.rows() * stride);
+
+    // padding cars stand still at 0, so the kernels need no tail loop
+    in_s.assign(stride, 0);
+    in_d.assign(stride, 0);
+    in_v.assign(stride, 0);
+    in_d_dot.assign(stride, 0);
+    in_a.assign(stride, 0);
+    in_t_stop.assign(stride, NEVER);
+    for (int i = 0; i < n; i++) {
+        in_s[i] = s[i];
+        in_d[i] = d[i];
+        in_v[i] = s_dot[i];
+        in_d_dot[i] = d_dot[i];
+        if (model == MOTION_CA) {
+            in_a[i] = s_ddot[i];
+            if (in_a[i] < 0) {
+                in_t_stop[i] = max(0.0, -in_v[i] / in_a[i]);
+            }
+        }
+    }
+
+    RolloutInputs in = {in_s.data(), in_d.data(), in_v.data(), in_d_dot.data(), in_a.data(), in_t_stop.data(),
+                        stride, out.rows(), dt, max_s, max_s > 0 ? 1.0 / max_s : 0.0};
+    rollout_kernel()(in, out.s.data(), out.d.data(), out.v.data());
+}
+
+const char *TrafficPredictor::kernel() {
+    return simd_level_name(simd_level());
+}
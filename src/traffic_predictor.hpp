@@ -0,0 +1,86 @@
+//
+//  traffic_predictor.hpp
+//  path_planning
+//
+//  Rolls every sensed car forward over the planning horizon in Frenet
+//  coordinates, under a constant velocity or constant acceleration model.
+//  The result is time-major, so the cars at one instant are contiguous and
+//  the rollout vectorizes across cars.
+//
+
+#ifndef traffic_predictor_hpp
+#define traffic_predictor_hpp
+
+#include <vector>
+
+using namespace std;
+
+enum MotionModel {
+    MOTION_CV,
+    MOTION_CA
+};
+
+// Predicted state of n cars at rows() instants, row k at time k*dt
+struct PredictionTensor {
+
+    int steps = 0;
+
+    int cars = 0;
+
+    // row length: cars rounded up to a whole vector
+    int stride = 0;
+
+    double dt = 0;
+
+    // s, d and s_dot of car i at row k are at [k*stride + i]
+    vector<double> s;
+
+    vector<double> d;
+
+    vector<double> v;
+
+    // steps + 1: row 0 is the sensed state
+    int rows() const { return steps + 1; }
+
+    const double *s_at(int row) const { return s.data() + row * stride; }
+
+    const double *d_at(int row) const { return d.data() + row * stride; }
+
+    const double *v_at(int row) const { return v.data() + row * stride; }
+
+    // row closest to t seconds ahead, clamped to the horizon
+    int row_at(double t) const;
+};
+
+class TrafficPredictor {
+public:
+
+    // horizon: steps of dt seconds
+    int steps;
+
+    double dt;
+
+    /**
+     * Constructor. The default horizon is 3 s at the simulator's 50 Hz.
+     */
+    TrafficPredictor(int steps = 150, double dt = 0.02);
+
+    /**
+     * Predicts n cars from their Frenet state into out. s_ddot is only read
+     * under MOTION_CA, where a braking car stops rather than reverses. d moves
+     * at d_dot under both models. s wraps into [0, max_s) unless max_s is 0.
+     * out keeps its storage across calls.
+     */
+    void predict(const double *s, const double *d, const double *s_dot, const double *d_dot, const double *s_ddot,
+                 int n, MotionModel model, double max_s, PredictionTensor &out);
+
+    // instruction set of the rollout kernel
+    static const char *kernel();
+
+private:
+
+    // inputs padded to the tensor stride, reused across calls
+    vector<double> in_s, in_d, in_v, in_d_dot, in_a, in_t_stop;
+};
+
+#endif /* traffic_predictor_hpp */
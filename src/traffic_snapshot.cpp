@@ -0,0 +1,134 @@
+//
+//  traffic_snapshot.cpp
+//  path_planning
+//
+//  The predicted state of the sensed cars for one frame, as flat arrays
+//  sorted by lane and then s. The cars of a lane are one contiguous range,
+//  so the behaviour planner's lane queries are binary searches over a few
+//  cache lines instead of walks over a map of per-car vectors.
+//
+
+#include "traffic_snapshot.hpp"
+
+#include <algorithm>
+
+
+template <typename T>
+static void permute(vector<T> &column, const vector<int> &order, vector<T> &scratch) {
+    scratch.resize(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        scratch[i] = column[order[i]];
+    }
+    column.swap(scratch);
+}
+
+void TrafficSnapshot::clear() {
+    id.clear();
+    lane.clear();
+    s.clear();
+    d.clear();
+    v.clear();
+    a.clear();
+    p_left.clear();
+    p_right.clear();
+    d_keep.clear();
+    d_left.clear();
+    d_right.clear();
+    for (int l = 0; l <= LANES; l++) {
+        offsets[l] = 0;
+    }
+}
+
+void TrafficSnapshot::add(int car_id, int car_lane, double car_s, double car_d, double car_v, double car_a) {
+    id.push_back(car_id);
+    lane.push_back(car_lane);
+    s.push_back(car_s);
+    d.push_back(car_d);
+    v.push_back(car_v);
+    a.push_back(car_a);
+    p_left.push_back(0);
+    p_right.push_back(0);
+    d_keep.push_back(car_d);
+    d_left.push_back(car_d);
+    d_right.push_back(car_d);
+}
+
+void TrafficSnapshot::set_intent(double car_p_left, double car_p_right, double car_d_keep, double car_d_left,
+                                 double car_d_right) {
+    p_left.back() = car_p_left;
+    p_right.back() = car_p_right;
+    d_keep.back() = car_d_keep;
+    d_left.back() = car_d_left;
+    d_right.back() = car_d_right;
+}
+
+void TrafficSnapshot::finish() {
+    int n = size();
+    order.resize(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    // id breaks ties, so equal cars come out in a fixed order
+    sort(order.begin(), order.end(), [this](int i, int j) {
+        if (lane[i] != lane[j]) {
+            return lane[i] < lane[j];
+        }
+        if (s[i] != s[j]) {
+            return s[i] < s[j];
+        }
+        return id[i] < id[j];
+    });
+    permute(id, order, int_scratch);
+    permute(lane, order, int_scratch);
+    permute(s, order, double_scratch);
+    permute(d, order, double_scratch);
+    permute(v, order, double_scratch);
+    permute(a, order, double_scratch);
+    permute(p_left, order, double_scratch);
+    permute(p_right, order, double_scratch);
+    permute(d_keep, order, double_scratch);
+    permute(d_left, order, double_scratch);
+    permute(d_right, order, double_scratch);
+
+    for (int l = 0; l <= LANES; l++) {
+        offsets[l] = lower_bound(lane.begin(), lane.end(), l) - lane.begin();
+    }
+}
+
+size_t TrafficSnapshot::size() const {
+    return id.size();
+}
+
+int TrafficSnapshot::lane_begin(int l) const {
+    return l >= 0 && l < LANES ? offsets[l] : 0;
+}
+
+int TrafficSnapshot::lane_end(int l) const {
+    return l >= 0 && l < LANES ? offsets[l + 1] : 0;
+}
+
+int TrafficSnapshot::lower_s(int begin, int end, double value) const {
+    return lower_bound(s.begin() + begin, s.begin() + end, value) - s.begin();
+}
+
+int TrafficSnapshot::upper_s(int begin, int end, double value) const {
+    return upper_bound(s.begin() + begin, s.begin() + end, value) - s.begin();
+}
+
+int TrafficSnapshot::first_ahead(int l, double car_s) const {
+    int end = lane_end(l);
+    int i = upper_s(lane_begin(l), end, car_s);
+    return i < end ? i : -1;
+}
+
+int TrafficSnapshot::last_behind(int l, double car_s) const {
+    int begin = lane_begin(l);
+    int i = lower_s(begin, lane_end(l), car_s);
+    return i > begin ? i - 1 : -1;
+}
+
+bool TrafficSnapshot::occupied(int l, double car_s) const {
+    int end = lane_end(l);
+    int i = lower_s(lane_begin(l), end, car_s);
+    return i < end && s[i] == car_s;
+}
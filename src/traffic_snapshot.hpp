@@ -0,0 +1,110 @@
+//
+//  traffic_snapshot.hpp
+//  path_planning
+//
+//  The predicted state of the sensed cars for one frame, as flat arrays
+//  sorted by lane and then s. The cars of a lane are one contiguous range,
+//  so the behaviour planner's lane queries are binary searches over a few
+//  cache lines instead of walks over a map of per-car vectors.
+//
+
+#ifndef traffic_snapshot_hpp
+#define traffic_snapshot_hpp
+
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+class TrafficSnapshot {
+public:
+
+    // lanes with ranges; cars off them (other carriageway) are in no lane query
+    static const int LANES = 3;
+
+    // one entry per car, in lane then s order once finish() ran
+    vector<int> id;
+
+    vector<int> lane;
+
+    vector<double> s;
+
+    vector<double> d;
+
+    vector<double> v;
+
+    vector<double> a;
+
+    // probability that the car changes into the lane on its left / right,
+    // see IntentPredictor; it keeps its lane otherwise
+    vector<double> p_left;
+
+    vector<double> p_right;
+
+    // d at the decision time if the car keeps its lane / changes left / right
+    vector<double> d_keep;
+
+    vector<double> d_left;
+
+    vector<double> d_right;
+
+    /**
+     * Empties the snapshot, keeping its storage for the next frame.
+     */
+    void clear();
+
+    /**
+     * Appends a car that surely keeps its lane, at d under every mode.
+     */
+    void add(int id, int lane, double s, double d, double v, double a);
+
+    /**
+     * Sets the lane-change intent of the car added last.
+     */
+    void set_intent(double p_left, double p_right, double d_keep, double d_left, double d_right);
+
+    /**
+     * Sorts the cars and builds the lane ranges. Call after the last add() and
+     * before any query.
+     */
+    void finish();
+
+    size_t size() const;
+
+    // the cars of lane are [lane_begin(lane), lane_end(lane)), empty off the road
+    int lane_begin(int lane) const;
+
+    int lane_end(int lane) const;
+
+    /**
+     * Index of the nearest car in lane with s greater than s, or -1.
+     */
+    int first_ahead(int lane, double s) const;
+
+    /**
+     * Index of the nearest car in lane with s less than s, or -1.
+     */
+    int last_behind(int lane, double s) const;
+
+    // true if a car in lane is exactly at s
+    bool occupied(int lane, double s) const;
+
+private:
+
+    // lane_begin of every lane, then lane_end of the last
+    int offsets[LANES + 1] = {0};
+
+    // sort permutation and the column being permuted, reused across frames
+    vector<int> order;
+
+    vector<int> int_scratch;
+
+    vector<double> double_scratch;
+
+    // first index in [begin, end) with s not less than (upper: greater than) value
+    int lower_s(int begin, int end, double value) const;
+
+    int upper_s(int begin, int end, double value) const;
+};
+
+#endif /* traffic_snapshot_hpp */
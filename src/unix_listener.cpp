@@ -0,0 +1,438 @@
+//
+//  unix_listener.cpp
+//  path_planning
+//
+//  The websocket protocol served on an AF_UNIX socket path, for clients on the
+//  same host that want to skip loopback TCP. A minimal RFC 6455 server on its
+//  own thread: no extensions, messages up to MAX_MESSAGE bytes.
+//
+
+#include "unix_listener.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <openssl/sha.h>
+#include <poll.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+// longest handshake request accepted
+static const size_t MAX_REQUEST = 8192;
+
+enum Opcode {
+    OPCODE_CONTINUATION = 0x0,
+    OPCODE_TEXT = 0x1,
+    OPCODE_BINARY = 0x2,
+    OPCODE_CLOSE = 0x8,
+    OPCODE_PING = 0x9,
+    OPCODE_PONG = 0xa
+};
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static string base64(const unsigned char *data, size_t length) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string out;
+    for (size_t i = 0; i < length; i += 3) {
+        unsigned v = data[i] << 16 | (i + 1 < length ? data[i + 1] << 8 : 0) | (i + 2 < length ? data[i + 2] : 0);
+        out += ALPHABET[v >> 18 & 63];
+        out += ALPHABET[v >> 12 & 63];
+        out += i + 1 < length ? ALPHABET[v >> 6 & 63] : '=';
+        out += i + 2 < length ? ALPHABET[v & 63] : '=';
+    }
+    return out;
+}
+
+// Value of header name in the request head, matched case-insensitively
+static string header_value(const string &request, const char *name) {
+    size_t name_length = strlen(name);
+    size_t line = request.find("\r\n");
+    while (line != string::npos && line + 2 < request.size()) {
+        size_t begin = line + 2;
+        size_t end = request.find("\r\n", begin);
+        if (end == string::npos) {
+            break;
+        }
+        if (end - begin > name_length && request[begin + name_length] == ':'
+            && strncasecmp(request.c_str() + begin, name, name_length) == 0) {
+            size_t value = request.find_first_not_of(" \t", begin + name_length + 1);
+            return value < end ? request.substr(value, end - value) : string();
+        }
+        line = end;
+    }
+    return string();
+}
+
+void UnixConnection::send(const char *data, size_t length, bool binary) {
+    send_frame(binary ? OPCODE_BINARY : OPCODE_TEXT, data, length);
+    flush();
+}
+
+void UnixConnection::send_frame(int opcode, const char *data, size_t length) {
+    char head[10];
+    size_t head_length;
+    head[0] = (char)(0x80 | opcode);
+    if (length < 126) {
+        head[1] = (char)length;
+        head_length = 2;
+    } else if (length < 65536) {
+        head[1] = 126;
+        head[2] = (char)(length >> 8);
+        head[3] = (char)length;
+        head_length = 4;
+    } else {
+        head[1] = 127;
+        for (int i = 0; i < 8; i++) {
+            head[2 + i] = (char)((uint64_t)length >> (56 - 8 * i));
+        }
+        head_length = 10;
+    }
+    out.insert(out.end(), head, head + head_length);
+    out.insert(out.end(), data, data + length);
+}
+
+bool UnixConnection::flush() {
+    size_t written = 0;
+    while (written < out.size()) {
+        ssize_t n = ::send(fd, out.data() + written, out.size() - written, SEND_FLAGS);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += n;
+    }
+    out.erase(out.begin(), out.begin() + written);
+    return written > 0 || out.empty() || errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+// bytes written to the wake pipe
+static const char WAKE_STOP = 0;
+static const char WAKE_HANDLER = 1;
+
+UnixListener::UnixListener() : wake_pending(false) {}
+
+UnixListener::~UnixListener() {
+    stop();
+    while (!connections.empty()) {
+        close_connection(connections.size() - 1);
+    }
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        unlink(path.c_str());
+    }
+}
+
+void UnixListener::on_connection(function<string(UnixConnection &, const string &)> handler) {
+    connection_handler = handler;
+}
+
+void UnixListener::on_message(function<void(UnixConnection &, char *, size_t, bool)> handler) {
+    message_handler = handler;
+}
+
+void UnixListener::on_disconnection(function<void(UnixConnection &)> handler) {
+    disconnection_handler = handler;
+}
+
+void UnixListener::on_drained(function<void(UnixConnection &)> handler) {
+    drained_handler = handler;
+}
+
+void UnixListener::on_wake(function<void()> handler) {
+    wake_handler = handler;
+}
+
+bool UnixListener::listen(const string &path_) {
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path_.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strcpy(address.sun_path, path_.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    unlink(path_.c_str());
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(fd, 16) != 0 || !set_nonblocking(fd)) {
+        ::close(fd);
+        return false;
+    }
+    listen_fd = fd;
+    path = path_;
+    return true;
+}
+
+void UnixListener::start() {
+    if (listen_fd < 0 || worker.joinable() || pipe(wake_fds) != 0) {
+        return;
+    }
+    worker = thread(&UnixListener::run, this);
+}
+
+void UnixListener::stop() {
+    if (worker.joinable()) {
+        while (write(wake_fds[1], &WAKE_STOP, 1) < 0 && errno == EINTR) {
+        }
+        worker.join();
+        ::close(wake_fds[0]);
+        ::close(wake_fds[1]);
+        wake_fds[0] = wake_fds[1] = -1;
+    }
+}
+
+void UnixListener::wake() {
+    if (worker.joinable() && !wake_pending.exchange(true)) {
+        while (write(wake_fds[1], &WAKE_HANDLER, 1) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+void UnixListener::run() {
+
+    vector<pollfd> fds;
+    while (true) {
+        /* slots 0 and 1 are the wake pipe and the listening socket, then one
+           per connection in the order of connections */
+        fds.resize(2 + connections.size());
+        fds[0] = {wake_fds[0], POLLIN, 0};
+        fds[1] = {listen_fd, POLLIN, 0};
+        for (size_t i = 0; i < connections.size(); i++) {
+            short events = connections[i]->out.empty() ? POLLIN : POLLIN | POLLOUT;
+            fds[2 + i] = {connections[i]->fd, events, 0};
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[0].revents) {
+            char c;
+            if (read(wake_fds[0], &c, 1) == 1 && c == WAKE_STOP) {
+                return;
+            }
+            wake_pending = false;
+            if (wake_handler) {
+                wake_handler();
+            }
+        }
+
+        // back to front, so closing one does not shift the ones still to visit
+        for (size_t i = connections.size(); i-- > 0;) {
+            UnixConnection &connection = *connections[i];
+            short revents = fds[2 + i].revents;
+            bool alive = true;
+            if (revents & POLLOUT) {
+                alive = connection.flush();
+            }
+            if (alive && (revents & (POLLIN | POLLHUP | POLLERR))) {
+                alive = receive(connection);
+            }
+            if (!alive || (connection.closing && connection.out.empty())) {
+                close_connection(i);
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            accept_connections();
+        }
+    }
+}
+
+void UnixListener::accept_connections() {
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        if (!set_nonblocking(fd)) {
+            ::close(fd);
+            continue;
+        }
+        unique_ptr<UnixConnection> connection(new UnixConnection());
+        connection->fd = fd;
+        connections.push_back(move(connection));
+    }
+}
+
+bool UnixListener::receive(UnixConnection &connection) {
+    char chunk[65536];
+    while (true) {
+        ssize_t n = recv(connection.fd, chunk, sizeof(chunk), 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+        connection.in.insert(connection.in.end(), chunk, chunk + n);
+        if ((size_t)n < sizeof(chunk)) {
+            break;
+        }
+    }
+    if (!connection.open && !handshake(connection)) {
+        return false;
+    }
+    return !connection.open || read_frames(connection);
+}
+
+bool UnixListener::handshake(UnixConnection &connection) {
+
+    string head(connection.in.begin(), connection.in.end());
+    size_t end = head.find("\r\n\r\n");
+    if (end == string::npos) {
+        return head.size() <= MAX_REQUEST;
+    }
+    head.resize(end + 2);
+    connection.in.erase(connection.in.begin(), connection.in.begin() + end + 4);
+
+    string key = header_value(head, "Sec-WebSocket-Key");
+    if (head.compare(0, 4, "GET ") != 0 || key.empty()) {
+        const char response[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        connection.out.insert(connection.out.end(), response, response + sizeof(response) - 1);
+        connection.flush();
+        return false;
+    }
+
+    key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1((const unsigned char *)key.data(), key.size(), digest);
+    string protocol = header_value(head, "Sec-WebSocket-Protocol");
+
+    connection.open = true;
+    string accepted;
+    if (connection_handler) {
+        accepted = connection_handler(connection, protocol);
+    }
+
+    string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n";
+    if (!accepted.empty()) {
+        // echo only what the session speaks, never a protocol it ignored
+        response += "Sec-WebSocket-Protocol: " + accepted + "\r\n";
+    }
+    response += "\r\n";
+    connection.out.insert(connection.out.end(), response.begin(), response.end());
+    return connection.flush();
+}
+
+bool UnixListener::read_frames(UnixConnection &connection) {
+
+    vector<char> &in = connection.in;
+    size_t consumed = 0;
+    bool delivered = false;
+    while (!connection.closing && in.size() - consumed >= 2) {
+        unsigned char *p = (unsigned char *)in.data() + consumed;
+        size_t available = in.size() - consumed;
+        bool fin = p[0] & 0x80;
+        int opcode = p[0] & 0x0f;
+        uint64_t length = p[1] & 0x7f;
+        size_t header = 2;
+        // clients must mask every frame
+        if (!(p[1] & 0x80)) {
+            return false;
+        }
+        if (length == 126) {
+            if (available < 4) {
+                break;
+            }
+            length = p[2] << 8 | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (available < 10) {
+                break;
+            }
+            length = 0;
+            for (int i = 0; i < 8; i++) {
+                length = length << 8 | p[2 + i];
+            }
+            header = 10;
+        }
+        if (length > MAX_MESSAGE || connection.message.size() + length > MAX_MESSAGE) {
+            return false;
+        }
+        if (available < header + 4 + length) {
+            break;
+        }
+
+        unsigned char *mask = p + header;
+        char *payload = (char *)mask + 4;
+        for (uint64_t i = 0; i < length; i++) {
+            payload[i] ^= mask[i & 3];
+        }
+        consumed += header + 4 + length;
+
+        switch (opcode) {
+            case OPCODE_TEXT:
+            case OPCODE_BINARY:
+                if (fin && connection.message.empty()) {
+                    // the common case: a whole message in one frame, handed over in place
+                    if (message_handler) {
+                        message_handler(connection, payload, length, opcode == OPCODE_BINARY);
+                    }
+                    delivered = true;
+                } else {
+                    connection.message.assign(payload, payload + length);
+                    connection.message_opcode = opcode;
+                }
+                break;
+            case OPCODE_CONTINUATION:
+                connection.message.insert(connection.message.end(), payload, payload + length);
+                if (fin) {
+                    if (message_handler) {
+                        message_handler(connection, connection.message.data(), connection.message.size(),
+                                        connection.message_opcode == OPCODE_BINARY);
+                    }
+                    connection.message.clear();
+                    delivered = true;
+                }
+                break;
+            case OPCODE_PING:
+                connection.send_frame(OPCODE_PONG, payload, length);
+                break;
+            case OPCODE_CLOSE:
+                connection.send_frame(OPCODE_CLOSE, payload, length < 2 ? length : 2);
+                connection.closing = true;
+                break;
+            default:
+                break;
+        }
+    }
+    in.erase(in.begin(), in.begin() + consumed);
+    if (delivered && drained_handler) {
+        drained_handler(connection);
+    }
+    return connection.flush();
+}
+
+void UnixListener::close_connection(size_t i) {
+    if (connections[i]->open && disconnection_handler) {
+        disconnection_handler(*connections[i]);
+    }
+    ::close(connections[i]->fd);
+    connections.erase(connections.begin() + i);
+}
@@ -0,0 +1,152 @@
+//
+//  unix_listener.hpp
+//  path_planning
+//
+//  The websocket protocol served on an AF_UNIX socket path, for clients on the
+//  same host that want to skip loopback TCP. A minimal RFC 6455 server on its
+//  own thread: no extensions, messages up to MAX_MESSAGE bytes.
+//
+
+#ifndef unix_listener_hpp
+#define unix_listener_hpp
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class UnixConnection {
+public:
+
+    // free for the owner of the listener, like uWS user data
+    void *user = nullptr;
+
+    /**
+     * Queues one message, binary or text, and writes as much of it as the
+     * socket takes. Call from the listener's callbacks only.
+     */
+    void send(const char *data, size_t length, bool binary);
+
+private:
+
+    friend class UnixListener;
+
+    int fd;
+
+    // set once the handshake is answered
+    bool open = false;
+
+    // set after a close frame: the connection ends once out is written
+    bool closing = false;
+
+    vector<char> in;
+
+    vector<char> out;
+
+    // fragments of a message in progress, and its opcode
+    vector<char> message;
+
+    int message_opcode = 0;
+
+    void send_frame(int opcode, const char *data, size_t length);
+
+    bool flush();
+};
+
+class UnixListener {
+public:
+
+    // longest message accepted before the connection is dropped
+    static const size_t MAX_MESSAGE = 1 << 20;
+
+    /**
+     * Constructor
+     */
+    UnixListener();
+
+    /**
+     * Destructor. Stops the thread, closes every connection and removes the
+     * socket file.
+     */
+    ~UnixListener();
+
+    UnixListener(const UnixListener &) = delete;
+    UnixListener &operator=(const UnixListener &) = delete;
+
+    // protocol is the client's Sec-WebSocket-Protocol header, empty if none;
+    // the handler returns the one it accepted, echoed in the handshake, or ""
+    void on_connection(function<string(UnixConnection &, const string &protocol)> handler);
+
+    // data is unmasked in place and valid during the call only
+    void on_message(function<void(UnixConnection &, char *data, size_t length, bool binary)> handler);
+
+    void on_disconnection(function<void(UnixConnection &)> handler);
+
+    // after the messages of one read were handed to on_message, so a handler
+    // can act on the newest only
+    void on_drained(function<void(UnixConnection &)> handler);
+
+    // on the listener thread, after wake()
+    void on_wake(function<void()> handler);
+
+    /**
+     * Binds the socket path, replacing a stale socket file.
+     */
+    bool listen(const string &path);
+
+    // serves connections on a thread of its own until stop()
+    void start();
+
+    void stop();
+
+    /**
+     * Runs the on_wake handler on the listener thread soon. Safe from any
+     * thread; wakes before the handler ran are merged.
+     */
+    void wake();
+
+private:
+
+    string path;
+
+    int listen_fd = -1;
+
+    // written by stop() and wake() to wake the thread from poll
+    int wake_fds[2] = {-1, -1};
+
+    atomic<bool> wake_pending;
+
+    thread worker;
+
+    vector<unique_ptr<UnixConnection>> connections;
+
+    function<string(UnixConnection &, const string &)> connection_handler;
+
+    function<void(UnixConnection &, char *, size_t, bool)> message_handler;
+
+    function<void(UnixConnection &)> disconnection_handler;
+
+    function<void(UnixConnection &)> drained_handler;
+
+    function<void()> wake_handler;
+
+    void run();
+
+    void accept_connections();
+
+    // false when the connection is done with and must be closed
+    bool receive(UnixConnection &connection);
+
+    bool handshake(UnixConnection &connection);
+
+    bool read_frames(UnixConnection &connection);
+
+    void close_connection(size_t i);
+};
+
+#endif /* unix_listener_hpp */
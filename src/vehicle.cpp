@@ -16,6 +16,8 @@
 #include "cost.hpp"
 
 
+bool Vehicle::verbose = false;
+
 /**
  * Initializes Vehicle
  */
@@ -38,23 +40,31 @@ Vehicle::Vehicle(int lane, float s, float d, float v, float a, string state) {
 
 Vehicle::~Vehicle() {}
 
+int Vehicle::lane_direction(const string &state) {
+    if (state == "PLCL" || state == "LCL") {
+        return -1;
+    }
+    if (state == "PLCR" || state == "LCR") {
+        return 1;
+    }
+    return 0;
+}
+
 
-vector<Vehicle> Vehicle::choose_next_state(map<int, vector<Vehicle>> predictions) {
+vector<Vehicle> Vehicle::choose_next_state(const TrafficSnapshot &traffic) {
     
     /*
-     INPUT: A predictions map. This is a map using vehicle id as keys with predicted
-     vehicle trajectories as values. A trajectory is a vector of Vehicle objects. The first
-     item in the trajectory represents the vehicle at the current timestep. The second item in
-     the trajectory represents the vehicle one timestep in the future.
+     INPUT: A traffic snapshot: the predicted state of every other vehicle, sorted by lane
+     and s.
      OUTPUT: The the best (lowest cost) trajectory for the ego vehicle corresponding to the next ego vehicle state.
      
      Functions that will be useful:
      1. successor_states() - Uses the current state to return a vector of possible successor states for the finite
      state machine.
-     2. generate_trajectory(string state, map<int, vector<Vehicle>> predictions) - Returns a vector of Vehicle objects
-     representing a vehicle trajectory, given a state and predictions. Note that trajectory vectors
+     2. generate_trajectory(string state, TrafficSnapshot traffic) - Returns a vector of Vehicle objects
+     representing a vehicle trajectory, given a state and the traffic. Note that trajectory vectors
      might have size 0 if no possible trajectory exists for the state.
-     3. calculate_cost(Vehicle vehicle, map<int, vector<Vehicle>> predictions, vector<Vehicle> trajectory) - Included from
+     3. calculate_cost(Vehicle vehicle, TrafficSnapshot traffic, vector<Vehicle> trajectory) - Included from
      cost.cpp, computes the cost for a trajectory.
      */
     
@@ -69,13 +79,15 @@ vector<Vehicle> Vehicle::choose_next_state(map<int, vector<Vehicle>> predictions
     vector<vector<Vehicle>> final_trajectories;
     
     for (vector<string>::iterator it = states.begin(); it != states.end(); ++it) {
-        cout<<"state "<<*it<<endl;
-        vector<Vehicle> state_trajectory = generate_trajectory(*it, predictions);
+        if (verbose) {
+            cout<<"state "<<*it<<endl;
+        }
+        vector<Vehicle> state_trajectory = generate_trajectory(*it, traffic);
         /*cout<<"state trajectory "<<endl;
         cout<<"acc "<<state_trajectory[1].a<<endl;
         cout<<"v "<<state_trajectory[1].v<<endl;*/
         if (state_trajectory.size() != 0) {
-            cost = calculate_cost(*this, predictions, state_trajectory);
+            cost = calculate_cost(*this, traffic, state_trajectory);
             //cout<<"cost is "<<cost<<endl;
             costs.push_back(cost);
             final_trajectories.push_back(state_trajectory);
@@ -121,7 +133,7 @@ vector<string> Vehicle::successor_states() {
     return states;
 }
 
-vector<Vehicle> Vehicle::generate_trajectory(string state, map<int, vector<Vehicle>> predictions) {
+vector<Vehicle> Vehicle::generate_trajectory(const string &state, const TrafficSnapshot &traffic) {
     /*
      Given a possible next state, generate the appropriate trajectory to realize the next state.
      */
@@ -129,16 +141,16 @@ vector<Vehicle> Vehicle::generate_trajectory(string state, map<int, vector<Vehic
     if (state.compare("CS") == 0) {
         trajectory = constant_speed_trajectory();
     } else if (state.compare("KL") == 0) {
-        trajectory = keep_lane_trajectory(predictions);
+        trajectory = keep_lane_trajectory(traffic);
     } else if (state.compare("LCL") == 0 || state.compare("LCR") == 0) {
-        trajectory = lane_change_trajectory(state, predictions);
+        trajectory = lane_change_trajectory(state, traffic);
     } else if (state.compare("PLCL") == 0 || state.compare("PLCR") == 0) {
-        trajectory = prep_lane_change_trajectory(state, predictions);
+        trajectory = prep_lane_change_trajectory(state, traffic);
     }
     return trajectory;
 }
 
-vector<double> Vehicle::get_kinematics(map<int, vector<Vehicle>> predictions, int lane) {
+vector<double> Vehicle::get_kinematics(const TrafficSnapshot &traffic, int lane) {
     /*
      Gets next timestep kinematics (position, velocity, acceleration)
      for a given lane. Tries to choose the maximum velocity and acceleration,
@@ -148,15 +160,14 @@ vector<double> Vehicle::get_kinematics(map<int, vector<Vehicle>> predictions, in
     double new_position;
     double new_velocity;
     double new_accel;
-    Vehicle vehicle_ahead;
-    Vehicle vehicle_behind;
+    int vehicle_ahead = get_vehicle_ahead(traffic, lane);
     
-    if (get_vehicle_ahead(predictions, lane, vehicle_ahead)) {
-        if (get_vehicle_behind(predictions, lane, vehicle_behind)) {
-            new_velocity = vehicle_ahead.v ;
+    if (vehicle_ahead >= 0) {
+        if (get_vehicle_behind(traffic, lane) >= 0) {
+            new_velocity = traffic.v[vehicle_ahead] ;
             //cout << "addapt velocity to  "<<new_velocity<<endl;
         } else {
-            new_velocity = vehicle_ahead.v + (vehicle_ahead.s - this->s- this->preferred_buffer)/this->dt  - (this->a)*this->dt;
+            new_velocity = traffic.v[vehicle_ahead] + (traffic.s[vehicle_ahead] - this->s- this->preferred_buffer)/this->dt  - (this->a)*this->dt;
             new_velocity = min(min(new_velocity , max_velocity_accel_limit), this->target_speed);
             //cout << "vel ahead "<<new_velocity<<endl;
         }
@@ -183,12 +194,12 @@ vector<Vehicle> Vehicle::constant_speed_trajectory() {
     return trajectory;
 }
 
-vector<Vehicle> Vehicle::keep_lane_trajectory(map<int, vector<Vehicle>> predictions) {
+vector<Vehicle> Vehicle::keep_lane_trajectory(const TrafficSnapshot &traffic) {
     /*
      Generate a keep lane trajectory.
      */
     vector<Vehicle> trajectory = {Vehicle(lane, this->s,this->d, this->v, this->a, state)};
-    vector<double> kinematics = get_kinematics(predictions, this->lane);
+    vector<double> kinematics = get_kinematics(traffic, this->lane);
     double new_s = kinematics[0];
     double new_v = kinematics[1];
     double new_a = kinematics[2];
@@ -196,7 +207,7 @@ vector<Vehicle> Vehicle::keep_lane_trajectory(map<int, vector<Vehicle>> predicti
     return trajectory;
 }
 
-vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions) {
+vector<Vehicle> Vehicle::prep_lane_change_trajectory(const string &state, const TrafficSnapshot &traffic) {
     /*
      Generate a trajectory preparing for a lane change.
      */
@@ -204,12 +215,11 @@ vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vect
     double new_s;
     double new_v;
     double new_a;
-    Vehicle vehicle_behind;
-    int new_lane = this->lane + lane_direction[state];
+    int new_lane = this->lane + lane_direction(state);
     vector<Vehicle> trajectory = {Vehicle(this->lane, this->s,this->d,this->v, this->a, this->state)};
-    vector<double> curr_lane_new_kinematics = get_kinematics(predictions, this->lane);
+    vector<double> curr_lane_new_kinematics = get_kinematics(traffic, this->lane);
     
-    if (get_vehicle_behind(predictions, this->lane, vehicle_behind)) {
+    if (get_vehicle_behind(traffic, this->lane) >= 0) {
         //Keep speed of current lane so as not to collide with car behind.
         new_s = curr_lane_new_kinematics[0];
         new_v = curr_lane_new_kinematics[1];
@@ -217,7 +227,7 @@ vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vect
         
     } else {
         vector<double> best_kinematics;
-        vector<double> next_lane_new_kinematics = get_kinematics(predictions, new_lane);
+        vector<double> next_lane_new_kinematics = get_kinematics(traffic, new_lane);
         //Choose kinematics with lowest velocity.
         if (next_lane_new_kinematics[1] < curr_lane_new_kinematics[1]) {
             best_kinematics = next_lane_new_kinematics;
@@ -233,24 +243,20 @@ vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vect
     return trajectory;
 }
 
-vector<Vehicle> Vehicle::lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions) {
+vector<Vehicle> Vehicle::lane_change_trajectory(const string &state, const TrafficSnapshot &traffic) {
     /*
      Generate a lane change trajectory.
      */
      //cout<<"LC"<<endl;
-    int new_lane = this->lane + lane_direction[state];
+    int new_lane = this->lane + lane_direction(state);
     vector<Vehicle> trajectory;
-    Vehicle next_lane_vehicle;
     //Check if a lane change is possible (check if another vehicle occupies that spot).
-    for (map<int, vector<Vehicle>>::iterator it = predictions.begin(); it != predictions.end(); ++it) {
-        next_lane_vehicle = it->second[0];
-        if (next_lane_vehicle.s == this->s && next_lane_vehicle.lane == new_lane) {
-            //If lane change is not possible, return empty trajectory.
-            return trajectory;
-        }
+    if (traffic.occupied(new_lane, this->s)) {
+        //If lane change is not possible, return empty trajectory.
+        return trajectory;
     }
     trajectory.push_back(Vehicle(this->lane, this->s,this->d, this->v, this->a, this->state));
-    vector<double> kinematics = get_kinematics(predictions, new_lane);
+    vector<double> kinematics = get_kinematics(traffic, new_lane);
     trajectory.push_back(Vehicle(new_lane, kinematics[0],this->d, kinematics[1], kinematics[2], state));
     return trajectory;
 }
@@ -264,42 +270,28 @@ double Vehicle::position_at(int t) {
     return this->s + this->v*this->dt ;
 }
 
-bool Vehicle::get_vehicle_behind(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle) {
+int Vehicle::get_vehicle_behind(const TrafficSnapshot &traffic, int lane) {
     /*
-     Returns a true if a vehicle is found behind the current vehicle, false otherwise. The passed reference
-     rVehicle is updated if a vehicle is found.
+     Returns the index of the nearest vehicle behind the current vehicle, -1 if there is none.
+     Searches the vehicle's own lane, as it always has.
      */
-    int max_s = -1;
-    bool found_vehicle = false;
-    Vehicle temp_vehicle;
-    for (map<int, vector<Vehicle>>::iterator it = predictions.begin(); it != predictions.end(); ++it) {
-        temp_vehicle = it->second[0];
-        if (temp_vehicle.lane == this->lane && temp_vehicle.s < this->s && temp_vehicle.s > max_s) {
-            max_s = temp_vehicle.s;
-            rVehicle = temp_vehicle;
-            found_vehicle = true;
-        }
+    int behind = traffic.last_behind(this->lane, this->s);
+    if (behind >= 0 && traffic.s[behind] > -1) {
+        return behind;
     }
-    return found_vehicle;
+    return -1;
 }
 
-bool Vehicle::get_vehicle_ahead(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle) {
+int Vehicle::get_vehicle_ahead(const TrafficSnapshot &traffic, int lane) {
     /*
-     Returns a true if a vehicle is found ahead of the current vehicle, false otherwise. The passed reference
-     rVehicle is updated if a vehicle is found.
+     Returns the index of the nearest vehicle ahead of the current vehicle, -1 if there is none.
+     Searches the vehicle's own lane, as it always has.
      */
-    int min_s = this->goal_s;
-    bool found_vehicle = false;
-    Vehicle temp_vehicle;
-    for (map<int, vector<Vehicle>>::iterator it = predictions.begin(); it != predictions.end(); ++it) {
-        temp_vehicle = it->second[0];
-        if (temp_vehicle.lane == this->lane && temp_vehicle.s > this->s && temp_vehicle.s < min_s) {
-            min_s = temp_vehicle.s;
-            rVehicle = temp_vehicle;
-            found_vehicle = true;
-        }
+    int ahead = traffic.first_ahead(this->lane, this->s);
+    if (ahead >= 0 && traffic.s[ahead] < this->goal_s) {
+        return ahead;
     }
-    return found_vehicle;
+    return -1;
 }
 
 vector<Vehicle> Vehicle::generate_predictions(int horizon) {
@@ -327,11 +319,11 @@ vector<Vehicle> Vehicle::generate_predictions(int horizon) {
     
 }
 
-void Vehicle::realize_next_state(vector<Vehicle> trajectory) {
+void Vehicle::realize_next_state(const vector<Vehicle> &trajectory) {
     /*
      Sets state and kinematics for ego vehicle using the last state of the trajectory.
      */
-    Vehicle next_state = trajectory[1];
+    const Vehicle &next_state = trajectory[1];
     this->state = next_state.state;
     this->lane = next_state.lane;
     this->s = next_state.s;
@@ -18,13 +18,19 @@
 #include <map>
 #include <string>
 #include <iterator>
+#include "traffic_snapshot.hpp"
 
 using namespace std;
 
 class Vehicle {
 public:
     
-    map<string, int> lane_direction = {{"PLCL", -1}, {"LCL", -1}, {"LCR", 1}, {"PLCR", 1}};
+    // lane offset a lane change state heads for: -1 left, 1 right, 0 none
+    static int lane_direction(const string &state);
+    
+    // print every frame's states, costs and decision to stdout. Off by
+    // default: every line takes the stream lock that all planning threads share
+    static bool verbose;
     
     struct collider{
         
@@ -80,39 +86,45 @@ public:
      */
     virtual ~Vehicle();
     
-    vector<Vehicle> choose_next_state(map<int, vector<Vehicle>> predictions);
+    vector<Vehicle> choose_next_state(const TrafficSnapshot &traffic);
     
     vector<string> successor_states();
     
-    vector<Vehicle> generate_trajectory(string state, map<int, vector<Vehicle>> predictions);
+    vector<Vehicle> generate_trajectory(const string &state, const TrafficSnapshot &traffic);
     
-    vector<double> get_kinematics(map<int, vector<Vehicle>> predictions, int lane);
+    vector<double> get_kinematics(const TrafficSnapshot &traffic, int lane);
     
     vector<Vehicle> constant_speed_trajectory();
     
-    vector<Vehicle> keep_lane_trajectory(map<int, vector<Vehicle>> predictions);
+    vector<Vehicle> keep_lane_trajectory(const TrafficSnapshot &traffic);
     
-    vector<Vehicle> lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions);
+    vector<Vehicle> lane_change_trajectory(const string &state, const TrafficSnapshot &traffic);
     
-    vector<Vehicle> prep_lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions);
+    vector<Vehicle> prep_lane_change_trajectory(const string &state, const TrafficSnapshot &traffic);
     
     void increment(int dt);
     
     double position_at(int t);
     
-    bool get_vehicle_behind(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle);
+    /**
+     * Index in traffic of the nearest car behind, or -1.
+     */
+    int get_vehicle_behind(const TrafficSnapshot &traffic, int lane);
     
-    bool get_vehicle_ahead(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle);
+    /**
+     * Index in traffic of the nearest car ahead, before goal_s, or -1.
+     */
+    int get_vehicle_ahead(const TrafficSnapshot &traffic, int lane);
     
     vector<Vehicle> generate_predictions(int horizon=2);
     
-    void realize_next_state(vector<Vehicle> trajectory);
+    void realize_next_state(const vector<Vehicle> &trajectory);
     
     void configure(int s,float max_acc, int lane);
     
-    float max_accel_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data);
+    float max_accel_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data);
     
-    float max_jerk_cost(Vehicle vehicle, vector<Vehicle> trajectory, map<int, vector<Vehicle>> predictions, map<string, float> data);
+    float max_jerk_cost(const Vehicle &vehicle, const vector<Vehicle> &trajectory, const TrafficSnapshot &traffic, map<string, float> &data);
     
 };
 
@@ -0,0 +1,181 @@
+//
+//  waypoint_index.cpp
+//  path_planning
+//
+//  Uniform grid over the map waypoints, built once at map load, answering
+//  nearest and next waypoint queries without scanning the whole map.
+//
+
+#include "waypoint_index.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include "frenet.hpp"
+
+
+WaypointIndex::WaypointIndex() {}
+
+WaypointIndex::WaypointIndex(const vector<double> &maps_x, const vector<double> &maps_y, double cell_size) {
+    build(maps_x, maps_y, cell_size);
+}
+
+void WaypointIndex::build(const vector<double> &maps_x, const vector<double> &maps_y, double cell_size) {
+
+    xs = maps_x;
+    ys = maps_y;
+    cell_start.clear();
+    cell_items.clear();
+    cols = 0;
+    rows = 0;
+
+    int n = xs.size();
+    if (n == 0) {
+        return;
+    }
+
+    double max_x = xs[0];
+    double max_y = ys[0];
+    min_x = xs[0];
+    min_y = ys[0];
+    double spacing = 0;
+    for (int i = 0; i < n; i++) {
+        min_x = min(min_x, xs[i]);
+        min_y = min(min_y, ys[i]);
+        max_x = max(max_x, xs[i]);
+        max_y = max(max_y, ys[i]);
+        if (i > 0) {
+            spacing += distance(xs[i-1], ys[i-1], xs[i], ys[i]);
+        }
+    }
+
+    if (cell_size <= 0) {
+        cell_size = n > 1 ? 2*spacing/(n-1) : 1.0;
+    }
+    // keep the grid within a few cells per waypoint on very sparse maps
+    cell_size = max(cell_size, sqrt((max_x-min_x)*(max_y-min_y)/(4.0*n)));
+    cell = max(cell_size, 1e-3);
+
+    cols = (int)floor((max_x-min_x)/cell) + 1;
+    rows = (int)floor((max_y-min_y)/cell) + 1;
+
+    // counting sort of the waypoints into their cells, keeping index order per cell
+    vector<int> cell_of(n);
+    cell_start.assign(cols*rows + 1, 0);
+    for (int i = 0; i < n; i++) {
+        int cx = min((int)((xs[i]-min_x)/cell), cols-1);
+        int cy = min((int)((ys[i]-min_y)/cell), rows-1);
+        cell_of[i] = cy*cols + cx;
+        cell_start[cell_of[i]+1]++;
+    }
+    for (int c = 0; c < cols*rows; c++) {
+        cell_start[c+1] += cell_start[c];
+    }
+    cell_items.resize(n);
+    vector<int> fill(cell_start.begin(), cell_start.end()-1);
+    for (int i = 0; i < n; i++) {
+        cell_items[fill[cell_of[i]]++] = i;
+    }
+}
+
+int WaypointIndex::size() const {
+    return xs.size();
+}
+
+void WaypointIndex::scan_cell(int cx, int cy, double x, double y, double &best_len, int &best) const {
+    if (cx < 0 || cy < 0 || cx >= cols || cy >= rows) {
+        return;
+    }
+    int c = cy*cols + cx;
+    for (int k = cell_start[c]; k < cell_start[c+1]; k++) {
+        int i = cell_items[k];
+        double dist = distance(x, y, xs[i], ys[i]);
+        if (dist < best_len || (dist == best_len && i < best)) {
+            best_len = dist;
+            best = i;
+        }
+    }
+}
+
+int WaypointIndex::closest(double x, double y) const {
+    /*
+     Searches rings of cells around the query cell, nearest ring first, and stops
+     once the next ring cannot hold a waypoint at least as close as the best found.
+     */
+    double closestLen = 100000; //large number, same cut-off as the linear scan
+    int closestWaypoint = 0;
+
+    if (xs.empty()) {
+        return closestWaypoint;
+    }
+
+    const double limit = 1 << 30;
+    int cx = (int)max(-limit, min(limit, floor((x-min_x)/cell)));
+    int cy = (int)max(-limit, min(limit, floor((y-min_y)/cell)));
+
+    // first and last rings that overlap the grid
+    int outside_x = cx < 0 ? -cx : (cx >= cols ? cx-cols+1 : 0);
+    int outside_y = cy < 0 ? -cy : (cy >= rows ? cy-rows+1 : 0);
+    int first_ring = max(outside_x, outside_y);
+    int last_ring = max(max(abs(cx), abs(cx-cols+1)), max(abs(cy), abs(cy-rows+1)));
+
+    for (int k = first_ring; k <= last_ring; k++) {
+        // every cell of ring k is at least k-1 whole cells away from the query
+        if (k > 0 && (k-1)*cell > closestLen) {
+            break;
+        }
+        if (k == 0) {
+            scan_cell(cx, cy, x, y, closestLen, closestWaypoint);
+            continue;
+        }
+        int x0 = max(cx-k, 0);
+        int x1 = min(cx+k, cols-1);
+        for (int i = x0; i <= x1; i++) {
+            scan_cell(i, cy-k, x, y, closestLen, closestWaypoint);
+            scan_cell(i, cy+k, x, y, closestLen, closestWaypoint);
+        }
+        int y0 = max(cy-k+1, 0);
+        int y1 = min(cy+k-1, rows-1);
+        for (int j = y0; j <= y1; j++) {
+            scan_cell(cx-k, j, x, y, closestLen, closestWaypoint);
+            scan_cell(cx+k, j, x, y, closestLen, closestWaypoint);
+        }
+    }
+
+    return closestWaypoint;
+
+}
+
+int WaypointIndex::next(double x, double y, double theta) const {
+    return next_from(closest(x, y), x, y, theta);
+}
+
+int WaypointIndex::next_from(int closest_wp, double x, double y, double theta) const {
+
+    int closestWaypoint = closest_wp;
+
+    if (xs.empty()) {
+        return closestWaypoint;
+    }
+
+    double map_x = xs[closestWaypoint];
+    double map_y = ys[closestWaypoint];
+
+    double heading = atan2( (map_y-y),(map_x-x) );
+
+    double angle = fabs(theta-heading);
+
+    angle = min(2*pi() - angle, angle);
+
+    if(angle > pi()/4)
+    {
+        closestWaypoint++;
+
+        if (closestWaypoint == (int)xs.size())
+        {
+            closestWaypoint = 0;
+        }
+    }
+
+    return closestWaypoint;
+
+}
@@ -0,0 +1,73 @@
+//
+//  waypoint_index.hpp
+//  path_planning
+//
+//  Uniform grid over the map waypoints, built once at map load, answering
+//  nearest and next waypoint queries without scanning the whole map.
+//
+
+#ifndef waypoint_index_hpp
+#define waypoint_index_hpp
+
+#include <vector>
+
+using namespace std;
+
+class WaypointIndex {
+public:
+
+    /**
+     * Constructor
+     */
+    WaypointIndex();
+    WaypointIndex(const vector<double> &maps_x, const vector<double> &maps_y, double cell_size = 0);
+
+    /**
+     * Buckets the waypoints into square cells of cell_size meters. A cell_size
+     * of 0 picks twice the mean waypoint spacing.
+     */
+    void build(const vector<double> &maps_x, const vector<double> &maps_y, double cell_size = 0);
+
+    /**
+     * Index of the waypoint closest to (x,y). Ties resolve to the lowest index,
+     * so the result matches a linear scan over the map.
+     */
+    int closest(double x, double y) const;
+
+    /**
+     * Index of the next waypoint ahead of a car at (x,y) with heading theta.
+     */
+    int next(double x, double y, double theta) const;
+
+    /**
+     * Same as next() for a caller that already knows the closest waypoint.
+     */
+    int next_from(int closest_wp, double x, double y, double theta) const;
+
+    int size() const;
+
+private:
+
+    vector<double> xs;
+
+    vector<double> ys;
+
+    double min_x = 0;
+
+    double min_y = 0;
+
+    double cell = 1;
+
+    int cols = 0;
+
+    int rows = 0;
+
+    // waypoints of cell c are cell_items[cell_start[c] .. cell_start[c+1]-1]
+    vector<int> cell_start;
+
+    vector<int> cell_items;
+
+    void scan_cell(int cx, int cy, double x, double y, double &best_len, int &best) const;
+};
+
+#endif /* waypoint_index_hpp */
@@ -0,0 +1,72 @@
+//
+//  xy_cache.cpp
+//  path_planning
+//
+//  Small direct-mapped cache in front of ReferenceLine::getXY for the few
+//  lane-centre points the planner converts over and over.
+//
+
+#include "xy_cache.hpp"
+
+#include <math.h>
+
+
+// key of an entry that was never filled; no quantized s reaches it
+static const long long EMPTY_KEY = -1;
+
+XYCache::XYCache(const ReferenceLine &line, int capacity, double s_step, double d_step)
+    : line(line), s_step(s_step), d_step(d_step), inv_s_step(1.0 / s_step), inv_d_step(1.0 / d_step) {
+
+    unsigned size = 1;
+    while ((int)size < capacity) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    entries.resize(size);
+    clear();
+}
+
+void XYCache::getXY(double s, double d, double &x, double &y) {
+    double sd[] = {s, d};
+    getXY(sd, 1, &x, &y);
+}
+
+void XYCache::getXY(const double *sd, int n, double *xs, double *ys) {
+
+    double max_s = line.length();
+    for (int i = 0; i < n; i++) {
+        double s = sd[2*i];
+        s -= floor(s / max_s) * max_s;
+        long long s_key = llround(s * inv_s_step);
+        long long d_key = llround(sd[2*i+1] * inv_d_step);
+
+        /* Neighbouring s of one lane land in neighbouring slots; the lane
+           offset is spread by an odd multiplier so lanes do not collide. */
+        Entry &entry = entries[(unsigned)(s_key + d_key * 40503) & mask];
+        if (entry.s_key != s_key || entry.d_key != d_key) {
+            // the batch form converts without allocating
+            double key_sd[] = {s_key * s_step, d_key * d_step};
+            line.getXY(key_sd, 1, &entry.x, &entry.y);
+            entry.s_key = s_key;
+            entry.d_key = d_key;
+            misses++;
+        } else {
+            hits++;
+        }
+        xs[i] = entry.x;
+        ys[i] = entry.y;
+    }
+}
+
+void XYCache::clear() {
+    for (Entry &entry : entries) {
+        entry.s_key = EMPTY_KEY;
+        entry.d_key = 0;
+    }
+    hits = 0;
+    misses = 0;
+}
+
+int XYCache::capacity() const {
+    return (int)entries.size();
+}
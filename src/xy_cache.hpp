@@ -0,0 +1,72 @@
+//
+//  xy_cache.hpp
+//  path_planning
+//
+//  Small direct-mapped cache in front of ReferenceLine::getXY for the few
+//  lane-centre points the planner converts over and over.
+//
+
+#ifndef xy_cache_hpp
+#define xy_cache_hpp
+
+#include <vector>
+#include "reference_line.hpp"
+
+using namespace std;
+
+class XYCache {
+public:
+
+    // lookups answered from the cache / passed on to the reference line
+    long hits = 0;
+
+    long misses = 0;
+
+    /**
+     * Constructor. Queries are rounded to multiples of s_step and d_step and
+     * the rounded point is what gets converted and cached, so a result does
+     * not depend on which query filled the entry. capacity is rounded up to a
+     * power of two.
+     *
+     * The cache holds no locks: give every planning thread its own instance
+     * over the shared, read-only reference line.
+     */
+    XYCache(const ReferenceLine &line, int capacity = 256, double s_step = 0.25, double d_step = 0.1);
+
+    // Transform from Frenet s,d coordinates to Cartesian x,y
+    void getXY(double s, double d, double &x, double &y);
+
+    /**
+     * Batch lookup of n interleaved (s,d) pairs into the caller's x and y arrays.
+     */
+    void getXY(const double *sd, int n, double *xs, double *ys);
+
+    void clear();
+
+    int capacity() const;
+
+private:
+
+    struct Entry {
+        long long s_key;
+        long long d_key;
+        double x;
+        double y;
+    };
+
+    const ReferenceLine &line;
+
+    double s_step;
+
+    double d_step;
+
+    double inv_s_step;
+
+    double inv_d_step;
+
+    unsigned mask;
+
+    vector<Entry> entries;
+};
+
+#endif /* xy_cache_hpp */